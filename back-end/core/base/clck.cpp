@@ -0,0 +1,100 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "clck.hpp"
+
+namespace core {
+
+    using clock = std::chrono::steady_clock;
+
+    static clock::duration       frame {};      // target frame interval
+    static clock::duration       spent {};      // analysis cost (moving average)
+    static clock::time_point     start {};      // analysis start
+    static clock::time_point     dline {};      // next frame deadline
+    static clock::time_point     epoch {};      // rate window start
+    static zx::f32               load  {0.5f};  // cpu budget per frame
+    static zx::u32               tick  {};      // frames since last capture (capture thread)
+    static zx::u32               done  {};      // analysed frames in rate window
+    static zx::u32               calm  {4};     // decimation while the scene is static
+    static zx::u32               most  {8};     // decimation limit
+    static std::atomic<zx::f32>  rate  {};
+    static std::atomic<zx::u32>  step  {1};
+}
+
+void
+zx::ck::init (const u32 rate, const f32 load) noexcept {
+
+    core::frame = std::chrono::duration_cast<core::clock::duration>(std::chrono::seconds(1)) / (rate ? rate : 1);
+    core::load  = (load > 0.0f and load <= 1.0f) ? load : 1.0f;
+    core::spent = {};
+    core::tick  = 0;
+    core::done  = 0;
+    core::dline = core::clock::now() + core::frame;
+    core::epoch = core::clock::now();
+    core::step  = 1;
+    core::rate  = 0.0f;
+}
+
+bool
+zx::ck::due (void) noexcept {
+    return ++core::tick >= core::step.load(std::memory_order_relaxed);
+}
+
+void
+zx::ck::take (void) noexcept {
+    core::tick = 0;
+}
+
+void
+zx::ck::open (void) noexcept {
+    core::start = core::clock::now();
+}
+
+void
+zx::ck::shut (const bool idle) noexcept {
+
+    const core::clock::time_point now = core::clock::now();
+
+    core::spent = (core::spent * 7 + (now - core::start)) / 8;
+    core::done += 1;
+
+    //// DECIMATION - KEEP ANALYSIS COST INSIDE THE CPU BUDGET
+    const f64 slot = f64(core::frame.count()) * core::load;
+    u32       step = u32(f64(core::spent.count()) / slot) + 1;
+
+    if (idle and step < core::calm) step = core::calm;
+    if (step > core::most)          step = core::most;
+
+    core::step.store(step, std::memory_order_relaxed);
+
+    if (now - core::epoch >= std::chrono::seconds(1)) {
+        const f64 span = std::chrono::duration<f64>(now - core::epoch).count();
+        core::rate.store(f32(core::done / span), std::memory_order_relaxed);
+        core::done  = 0;
+        core::epoch = now;
+    }
+}
+
+void
+zx::ck::wait (void) noexcept {
+
+    const core::clock::time_point now = core::clock::now();
+
+    if (now < core::dline) {
+        std::this_thread::sleep_until(core::dline);
+        core::dline += core::frame;
+    } else {
+        core::dline = now + core::frame; // overrun: drop the missed deadlines
+    }
+}
+
+zx::f32
+zx::ck::rate (void) noexcept {
+    return core::rate.load(std::memory_order_relaxed);
+}
+
+zx::u32
+zx::ck::step (void) noexcept {
+    return core::step.load(std::memory_order_relaxed);
+}
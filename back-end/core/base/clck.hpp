@@ -0,0 +1,20 @@
+#ifndef __ZX_FRAME_SCHEDULER_HPP__
+#define __ZX_FRAME_SCHEDULER_HPP__ 1
+
+#include "defs.hpp"
+
+namespace zx::ck
+{
+    void init (const u32, const f32) noexcept ; // target frames per second, cpu budget (0..1]
+
+    bool due  (void)       noexcept ;           // analyse this frame (decimation)
+    void take (void)       noexcept ;           // frame captured for analysis, decimation restarts
+    void open (void)       noexcept ;           // analysis start
+    void shut (const bool) noexcept ;           // analysis end (scene static)
+    void wait (void)       noexcept ;           // sleep until next frame deadline
+
+    f32  rate (void) noexcept ;                 // achieved analysis rate (any thread)
+    u32  step (void) noexcept ;                 // current decimation (any thread)
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "conf.hpp"
+
+namespace core {
+    static zx::cf::conf data {};
+}
+
+static std::string
+trim (const std::string& s) noexcept {
+    const std::size_t start = s.find_first_not_of(" \t\r");
+    const std::size_t end   = s.find_last_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    return s.substr(start, end - start + 1);
+}
+
+//// whole value must be a number inside [min, max]
+static bool
+number (const std::string& value, const zx::f64 min, const zx::f64 max, zx::f64& out) noexcept {
+    char *end = nullptr;
+    out = std::strtod(value.c_str(), &end);
+    return not value.empty() and end and *end == '\0' and out >= min and out <= max;
+}
+
+static bool
+apply (zx::cf::conf& c, const std::string& key, const std::string& value) noexcept {
+
+    using zx::u16, zx::u32, zx::f32;
+
+    zx::f64 v = 0.0;
+
+    if (key == "device")  { c.device = value; return not value.empty(); }
+    if (key == "shm")     { c.shm    = value; return value.size() > 1 and value[0] == '/'; }
+    if (key == "log")     { c.log    = value; return not value.empty(); }
+    if (key == "svg")     { c.svg    = value; return not value.empty(); }
+    if (key == "trace")   { c.trace  = value; return not value.empty(); }
+    if (key == "layout")  { c.layout = value; return true; }
+    if (key == "bind")    { c.bind   = value; return not value.empty(); }
+    if (key == "viewer")  { c.viewer = value; return not value.empty(); }
+
+    if (key == "width")   { if (not number(value, 160, 7680, v)) return false; c.size.w  = u32(v); return true; }
+    if (key == "height")  { if (not number(value, 120, 4320, v)) return false; c.size.h  = u32(v); return true; }
+    if (key == "rate")    { if (not number(value, 1, 240, v))    return false; c.rate    = u32(v); return true; }
+    if (key == "port")    { if (not number(value, 1, 65535, v))  return false; c.port    = u16(v); return true; }
+    if (key == "camera")  { if (not number(value, 0, 65535, v))  return false; c.camera  = u16(v); return true; }
+    if (key == "preview") { if (not number(value, 0, 65535, v))  return false; c.preview = u16(v); return true; }
+    if (key == "fps")     { if (not number(value, 1, 60, v))     return false; c.fps     = u32(v); return true; }
+    if (key == "block")   { if (not number(value, 0, 8, v) or (v > 0 and v < 2)) return false; c.block = u32(v); return true; }
+    if (key == "lean")    { if (not number(value, 0, 1, v))      return false; c.lean    = v > 0.0; return true; }
+    if (key == "glyph")   { if (not number(value, 6, 64, v))     return false; c.glyph   = u32(v); return true; }
+    if (key == "scales")  { if (not number(value, 1, 4, v))      return false; c.scales  = u32(v); return true; }
+
+    if (key == "load")    { if (not number(value, 0.05, 1.0, v)) return false; c.load    = f32(v); return true; }
+    if (key == "level")   { if (not number(value, 0.1, 1.0, v))  return false; c.level   = f32(v); return true; }
+    if (key == "busy")    { if (not number(value, 0.01, 2.0, v)) return false; c.busy    = f32(v); return true; }
+    if (key == "bounce")  { if (not number(value, 0.01, 2.0, v)) return false; c.bounce  = f32(v); return true; }
+    if (key == "lock")    { if (not number(value, 0, 1, v))      return false; c.lock    = v > 0.0; return true; }
+    if (key == "drift")   { if (not number(value, 1, 128, v))    return false; c.drift   = f32(v); return true; }
+
+    return false;
+}
+
+bool
+zx::cf::load (const char* path) noexcept {
+
+    std::ifstream file(path);
+
+    if (not file) {
+        std::fprintf(stderr, "info: %s ausente, mantendo a configuracao atual\n", path);
+        return false;
+    }
+
+    conf        next {};               // reload == restart: unset keys are defaults
+    std::string line {};
+    u32         row  {0};
+
+    while (std::getline(file, line)) {
+
+        ++row;
+
+        const std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        line = trim(line);
+        if (line.empty()) continue;
+
+        const std::size_t eq = line.find('=');
+        const std::string key   = eq == std::string::npos ? line : trim(line.substr(0, eq));
+        const std::string value = eq == std::string::npos ? ""   : trim(line.substr(eq + 1));
+
+        conf probe = next;
+
+        if (eq == std::string::npos or not apply(probe, key, value)) {
+            std::fprintf(stderr, "erro: %s:%u entrada invalida '%s'\n", path, row, line.c_str());
+            continue;
+        }
+
+        next = probe;
+    }
+
+    core::data = next;
+
+    return true;
+}
+
+const zx::cf::conf&
+zx::cf::data (void) noexcept {
+    return core::data;
+}
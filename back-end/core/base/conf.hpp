@@ -0,0 +1,50 @@
+#ifndef __ZX_SITE_CONFIGURATION_HPP__
+#define __ZX_SITE_CONFIGURATION_HPP__ 1
+
+#include <string>
+#include "defs.hpp"
+
+namespace zx::cf
+{
+    //// key = value per line, # comments - missing or invalid keys take the default
+    struct conf final {
+        //// CAMERA (restart)
+        std::string device  {"/dev/video0"};
+        su32        size    {1920, 1080};  // largest camera mode accepted
+        u32         rate    {30};          // target frame rate
+        bool        lean    {false};       // minimal memory: stages in one thread, detection by rows
+
+        //// OUTPUTS (restart)
+        std::string shm     {"/park"};
+        std::string log     {"/var/lib/park/events.bin"};
+        std::string trace   {"/var/lib/park/trace.json"}; // 'trace' command output (next dump)
+        u16         camera  {0};           // instance id in the event log (one per camera of a site)
+
+        //// SERVERS (restarted on reload when changed)
+        std::string bind    {"0.0.0.0"};
+        u16         port    {12345};       // control
+        u16         preview {8080};        // mjpeg, 0 = off
+        std::string viewer  {"127.0.0.1"}; // mjpeg bind address, camera images stay local by default
+        u32         fps     {10};          // mjpeg frame rate
+
+        //// ANALYSIS (next frame)
+        f32         load    {0.5f};        // cpu budget
+        f32         level   {0.80f};       // glyph correlation accepted as a marker
+        f32         busy    {0.25f};       // lot diff above which it is occupied
+        f32         bounce  {0.5f};        // frame diff ignored as camera movement
+        bool        lock    {false};       // camera exposure, gain and white balance held after UPDATE
+        f32         drift   {12.0f};       // mean gray change that releases the lock
+        std::string svg     {"/usr/share/nginx/html/face/image.svg"};
+
+        //// GEOMETRY (rebuilt between two frames, lots and models rescaled)
+        u32         block   {0};           // camera pixels per low res pixel, 0 = from camera size
+        u32         glyph   {15};          // marker size in low res pixels
+        u32         scales  {3};           // glyph sizes per octave, markers from half to twice the glyph, 1 = glyph only
+        std::string layout  {};            // bay polygons in camera pixels, empty = lot rectangles
+    };
+
+    bool load (const char*) noexcept ;     // false when the file is missing, current values kept
+    const conf& data (void) noexcept ;
+}
+
+#endif
@@ -2,8 +2,17 @@
 #ifndef __ZX_UI_DEFINES_HPP__
 #define __ZX_UI_DEFINES_HPP__ 1
 
+#include <cassert>
 #include <cstdint>
 
+//// HOT KERNELS - ONE CLONE PER x86-64 LEVEL (sse4.2, avx2, avx-512), THE LOADER
+//// PICKS THE BEST ONCE AT STARTUP (ifunc). aarch64 always has neon, baseline is enough.
+#if defined(__x86_64__) and defined(__GNUC__) and not defined(__clang__)
+#define ZX_CLONES __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define ZX_CLONES
+#endif
+
 namespace zx
 {
     using i08 = std::int8_t;
@@ -20,6 +29,42 @@ namespace zx
     struct ru32 final { zx::u32 x{0}, y{0}, w{0}, h{0}; };
     struct su32 final { zx::u32 w{0}, h{0}; };
     struct pu32 final { zx::u32 x{0}, y{0}; };
+    struct pf32 final { zx::f32 x{0}, y{0}; };
+    struct rf32 final { zx::f32 x{0}, y{0}, w{0}, h{0}; };
+    struct run  final { zx::u32 y{0}, x{0}, n{0}; }; // n pixels of row y from x
+
+    //// NON-OWNING STRIDED WINDOW - rows are stride bytes apart
+    struct view final {
+        u08 *data   {nullptr};
+        u32  width  {0};
+        u32  height {0};
+        u32  stride {0};
+
+        u08* row (const u32 y) const noexcept {
+            assert(y < height);
+            return data + u64(y) * stride;
+        }
+
+        u08& at (const u32 x, const u32 y) const noexcept {
+            assert(x < width);
+            return row(y)[x];
+        }
+
+        //// area must lie inside the view (checked in debug)
+        view crop (const ru32& area) const noexcept {
+            assert(u64(area.x) + area.w <= width and u64(area.y) + area.h <= height);
+            return { data + u64(area.y) * stride + area.x, area.w, area.h, stride };
+        }
+
+        //// area clamped to the view bounds
+        ru32 clip (const ru32& area) const noexcept {
+            const u64 sx = area.x < width  ? area.x : width;
+            const u64 sy = area.y < height ? area.y : height;
+            const u64 ex = u64(area.x) + area.w < width  ? u64(area.x) + area.w : width;
+            const u64 ey = u64(area.y) + area.h < height ? u64(area.y) + area.h : height;
+            return { u32(sx), u32(sy), u32(ex > sx ? ex - sx : 0), u32(ey > sy ? ey - sy : 0) };
+        }
+    };
 
     struct graph final {
         u32  width  {0};
@@ -29,6 +74,10 @@ namespace zx
         f32  vari   {0}; // std  variation
         f32  stdv   {0}; // std  deviation
         u08 *data   {nullptr};
+
+        operator view (void) const noexcept {
+            return { data, width, height, width };
+        }
     };
 
     struct match final {
@@ -36,6 +85,7 @@ namespace zx
         f32  score {};
         u32  busy  {};
         ru32 area  {};
+        u32  id    {}; // lot id, stable across REMAP
     };
 
     struct frame final {
@@ -0,0 +1,121 @@
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+
+#include "heap.hpp"
+
+namespace core {
+    static zx::u08 *base {nullptr}; // arena start (page aligned)
+    static zx::u64  size {0};       // reserved bytes
+    static zx::u64  head {0};       // bump offset
+}
+
+bool
+zx::mm::init (const u64 size, const bool huge) noexcept {
+
+    if (nullptr != core::base) return true;
+
+    const u64 page = huge ? (2u << 20) : u64(sysconf(_SC_PAGESIZE));
+    const u64 span = (size + page - 1) & ~(page - 1);
+
+    void *data = MAP_FAILED;
+
+    //// HUGE PAGES RESERVED BY THE KERNEL (vm.nr_hugepages)
+    if (huge)
+        data = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+    //// REGULAR PAGES - TRANSPARENT HUGE PAGES WHEN AVAILABLE
+    if (MAP_FAILED == data) {
+        data = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (huge and MAP_FAILED != data)
+            madvise(data, span, MADV_HUGEPAGE);
+    }
+
+    if (MAP_FAILED == data) {
+        std::fprintf(stderr, "erro: memoria insuficiente para arena (%lu bytes)\n", span);
+        return false;
+    }
+
+    core::base = static_cast<u08*>(data);
+    core::size = span;
+    core::head = 0;
+
+    return true;
+}
+
+void
+zx::mm::stop (void) noexcept {
+
+    if (nullptr == core::base) return;
+
+    if (-1 == munmap(core::base, core::size))
+        std::fprintf(stderr, "erro: falha ao liberar arena\n");
+
+    core::base = nullptr;
+    core::size = 0;
+    core::head = 0;
+}
+
+zx::u08*
+zx::mm::take (const u64 size) noexcept {
+
+    const u64 span = (size + mm::align - 1) & ~(mm::align - 1);
+
+    if (nullptr == core::base or core::head + span > core::size) {
+        std::fprintf(stderr, "erro: arena esgotada (%lu de %lu bytes)\n", core::head + span, core::size);
+        return nullptr;
+    }
+
+    u08 *data = core::base + core::head;
+    core::head += span;
+
+    return data;
+}
+
+zx::graph
+zx::mm::image (const su32 size) noexcept {
+
+    graph image {};
+
+    image.width  = size.w;
+    image.height = size.h;
+    image.size   = size.w * size.h;
+    image.data   = take(image.size);
+
+    return image;
+}
+
+zx::u64
+zx::mm::mark (void) noexcept {
+    return core::head;
+}
+
+void
+zx::mm::drop (const u64 mark) noexcept {
+    if (mark <= core::head) core::head = mark;
+}
+
+zx::u64
+zx::mm::used (void) noexcept {
+    return core::head;
+}
+
+zx::u64
+zx::mm::size (void) noexcept {
+    return core::size;
+}
+
+//// /proc/self/statm: size resident shared ... in pages
+zx::u64
+zx::mm::rss (void) noexcept {
+
+    std::FILE *file = std::fopen("/proc/self/statm", "r");
+    unsigned long pages = 0, resident = 0;
+
+    if (nullptr == file) return 0;
+
+    const int read = std::fscanf(file, "%lu %lu", &pages, &resident);
+    std::fclose(file);
+
+    return 2 == read ? u64(resident) * u64(sysconf(_SC_PAGESIZE)) : 0;
+}
@@ -0,0 +1,23 @@
+#ifndef __ZX_MEMORY_ARENA_HPP__
+#define __ZX_MEMORY_ARENA_HPP__ 1
+
+#include "defs.hpp"
+
+namespace zx::mm
+{
+    constexpr u64 align {64}; // cache line / avx-512 register
+
+    bool init (const u64, const bool) noexcept ; // reserve arena once (bytes, huge pages)
+    void stop (void) noexcept ;                  // release arena back to the kernel
+
+    u08*  take (const u64)  noexcept ;           // 64-byte aligned slice, nullptr when exhausted
+    graph image(const su32) noexcept ;           // frame sized slice
+    u64   mark (void)       noexcept ;           // current arena offset
+    void  drop (const u64)  noexcept ;           // release every slice taken after mark
+
+    u64  used (void) noexcept ;
+    u64  size (void) noexcept ;
+    u64  rss  (void) noexcept ;                  // resident bytes of the whole process
+}
+
+#endif
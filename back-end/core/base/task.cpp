@@ -0,0 +1,170 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "task.hpp"
+
+namespace core {
+
+    //// ONE DEQUE PER WORKER - owner works at the back, thieves take the front
+    struct lane final {
+        std::mutex             mutex {};
+        std::deque<zx::tk::job> jobs {};
+    };
+
+    static std::vector<std::unique_ptr<lane>> lanes   {};
+    static std::vector<std::thread>           threads {};
+    static std::atomic<bool>                  running {false};
+    static std::atomic<zx::u32>               pending {0};   // queued jobs
+    static std::atomic<zx::u32>               next    {0};   // round robin for outside posts
+    static std::mutex                         sleep   {};
+    static std::condition_variable            wake    {};
+    static thread_local zx::i32               self    {-1};  // worker index
+}
+
+static bool find (zx::tk::job& job) noexcept {
+
+    const zx::u32 n = zx::u32(core::lanes.size());
+
+    if (core::self >= 0) {
+        core::lane& own = *core::lanes[zx::u32(core::self)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (not own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            core::pending -= 1;
+            return true;
+        }
+    }
+
+    const zx::u32 base = core::self >= 0 ? zx::u32(core::self) : 0;
+
+    for (zx::u32 k = 1; k <= n; ++k) {
+        core::lane& other = *core::lanes[(base + k) % n];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (not other.jobs.empty()) {
+            job = std::move(other.jobs.front());
+            other.jobs.pop_front();
+            core::pending -= 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void worker (const zx::u32 index) noexcept {
+
+    core::self = zx::i32(index);
+
+    for (;;) {
+        zx::tk::job job {};
+
+        if (find(job)) {
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(core::sleep);
+        core::wake.wait(lock, [] { return core::pending > 0 or not core::running; });
+
+        if (not core::running and 0 == core::pending) return;
+    }
+}
+
+void
+zx::tk::init (const u32 count) noexcept {
+
+    if (core::running) return;
+
+    const u32 cores = std::thread::hardware_concurrency();
+    const u32 total = count ? count : (cores > 1 ? cores - 1 : 0);
+
+    core::running = true;
+
+    for (u32 i = 0; i < total; ++i)
+        core::lanes.push_back(std::make_unique<core::lane>());
+
+    for (u32 i = 0; i < total; ++i)
+        core::threads.emplace_back(worker, i);
+}
+
+void
+zx::tk::stop (void) noexcept {
+
+    if (not core::running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(core::sleep);
+        core::running = false;
+    }
+
+    core::wake.notify_all();
+
+    for (std::thread& t : core::threads)
+        if (t.joinable()) t.join();
+
+    core::threads.clear();
+    core::lanes.clear();
+}
+
+void
+zx::tk::post (job job) noexcept {
+
+    if (core::lanes.empty()) {
+        job();                              // no workers: run inline
+        return;
+    }
+
+    const u32 n = u32(core::lanes.size());
+    const u32 k = core::self >= 0 ? u32(core::self) : core::next++ % n;
+
+    {
+        std::lock_guard<std::mutex> lock(core::sleep);
+        core::pending += 1;                 // counted before it can be taken
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(core::lanes[k]->mutex);
+        core::lanes[k]->jobs.push_back(std::move(job));
+    }
+
+    core::wake.notify_one();
+}
+
+void
+zx::tk::loop (const u32 count, const u32 grain, const part& part) noexcept {
+
+    const u32 step = grain ? grain : 1;
+
+    if (core::lanes.empty() or count <= step) {
+        part(0, count);
+        return;
+    }
+
+    std::atomic<u32> left {(count + step - 1) / step};
+
+    for (u32 b = 0; b < count; b += step) {
+        const u32 e = (b + step < count) ? b + step : count;
+        post([&part, &left, b, e] {
+            part(b, e);
+            left.fetch_sub(1, std::memory_order_release);
+        });
+    }
+
+    //// CALLER HELPS - STEAL UNTIL EVERY CHUNK IS DONE
+    while (left.load(std::memory_order_acquire)) {
+        job job {};
+        if (find(job)) job();
+        else std::this_thread::yield();
+    }
+}
+
+zx::u32
+zx::tk::size (void) noexcept {
+    return u32(core::lanes.size());
+}
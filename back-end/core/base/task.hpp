@@ -0,0 +1,21 @@
+#ifndef __ZX_WORK_STEALING_EXECUTOR_HPP__
+#define __ZX_WORK_STEALING_EXECUTOR_HPP__ 1
+
+#include <functional>
+#include "defs.hpp"
+
+namespace zx::tk
+{
+    using job  = std::function<void (void)>;
+    using part = std::function<void (const u32, const u32)>; // [begin, end)
+
+    void init (const u32) noexcept ;   // workers, 0 = one per core besides the caller
+    void stop (void) noexcept ;        // runs what is queued, then joins
+
+    void post (job) noexcept ;         // worker: own deque, outside: round robin
+    void loop (const u32, const u32, const part&) noexcept ; // count, grain - caller helps until done
+
+    u32  size (void) noexcept ;        // workers
+}
+
+#endif
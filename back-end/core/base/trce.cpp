@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trce.hpp"
+
+namespace core {
+
+    using clock = std::chrono::steady_clock;
+
+    static constexpr zx::u64 depth {8192};      // events kept per thread
+
+    //// FIELDS ARE ATOMIC SO DUMP MAY READ A SLOT THE OWNER IS REWRITING - IT IS DISCARDED
+    struct event final {
+        std::atomic<const char*> label {nullptr};
+        std::atomic<zx::i64>     begin {0};
+        std::atomic<zx::i64>     end   {0};
+    };
+
+    struct track final {                        // ring of one thread
+        event                    slot[depth] {};
+        std::atomic<zx::u64>     head  {0};     // events written, owner thread only
+        std::atomic<const char*> label {nullptr};
+        std::atomic<bool>        owned {false}; // a live thread writes here
+        zx::u32                  tid   {0};
+    };
+
+    //// RING GIVEN BACK WHEN ITS THREAD EXITS - stage threads restarted by reload reuse it
+    struct owner final {
+        track *r {nullptr};
+        ~owner () noexcept { if (r) r->owned.store(false, std::memory_order_release); }
+    };
+
+    static std::mutex                          mutex  {}; // registration and dump
+    static std::vector<std::unique_ptr<track>> tracks {}; // events outlive their thread
+    static thread_local owner                  mine   {};
+    static const clock::time_point             epoch  {clock::now()};
+}
+
+//// calling thread ring, taken on its first event
+static core::track&
+local (void) noexcept {
+
+    if (core::mine.r) return *core::mine.r;
+
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    for (const std::unique_ptr<core::track>& r : core::tracks) {
+        if (r->owned.load(std::memory_order_acquire)) continue;
+        r->label.store(nullptr, std::memory_order_relaxed);
+        core::mine.r = r.get();
+        break;
+    }
+
+    if (not core::mine.r) {
+        core::tracks.push_back(std::make_unique<core::track>());
+        core::mine.r      = core::tracks.back().get();
+        core::mine.r->tid = zx::u32(core::tracks.size());
+    }
+
+    core::mine.r->owned.store(true, std::memory_order_relaxed);
+
+    return *core::mine.r;
+}
+
+zx::i64
+zx::tr::now (void) noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(core::clock::now() - core::epoch).count();
+}
+
+void
+zx::tr::push (const char* label, const i64 begin, const i64 end) noexcept {
+
+    core::track& r = local();
+    const u64   h = r.head.load(std::memory_order_relaxed);
+    core::event& e = r.slot[h % core::depth];
+
+    e.label.store(label, std::memory_order_relaxed);
+    e.begin.store(begin, std::memory_order_relaxed);
+    e.end.store(end,     std::memory_order_relaxed);
+
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void
+zx::tr::name (const char* label) noexcept {
+    local().label.store(label, std::memory_order_relaxed);
+}
+
+bool
+zx::tr::dump (const char* path) noexcept {
+
+#if not defined(ZX_TRACE)
+    std::fprintf(stderr, "info: rastreamento desligado, compile com TRACE=1 (%s)\n", path);
+    return false;
+#else
+    std::string out {"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"};
+    bool        first {true};
+
+    const auto line = [&](const std::string& s) {
+        if (not first) out += ",\n";
+        out  += s;
+        first = false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(core::mutex);
+
+        for (const std::unique_ptr<core::track>& r : core::tracks) {
+
+            const char *label = r->label.load(std::memory_order_relaxed);
+
+            line(std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                r->tid, label ? label : "worker"));
+
+            //// SNAPSHOT, THEN DROP WHAT THE OWNER OVERWROTE MEANWHILE
+            const u64 head = r->head.load(std::memory_order_acquire);
+            const u64 from = head > core::depth ? head - core::depth : 0;
+
+            struct seen final { const char *label; i64 begin, end; };
+            std::vector<seen> copy(head - from);
+
+            for (u64 i = from; i < head; ++i) {
+                const core::event& e = r->slot[i % core::depth];
+                copy[i - from] = { e.label.load(std::memory_order_relaxed),
+                                   e.begin.load(std::memory_order_relaxed),
+                                   e.end.load(std::memory_order_relaxed) };
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            const u64 last = r->head.load(std::memory_order_relaxed);
+            const u64 safe = last >= core::depth ? last - core::depth + 1 : 0; // slot 'last' may be mid-write
+
+            for (u64 i = std::max(from, safe); i < head; ++i) {
+                const seen& e = copy[i - from];
+                line(std::format(R"({{"name":"{}","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f}}})",
+                    e.label, r->tid, f64(e.begin) / 1e3, f64(e.end - e.begin) / 1e3));
+            }
+        }
+    }
+
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    if (not (file << out)) {
+        std::fprintf(stderr, "erro: falha ao gravar %s\n", path);
+        return false;
+    }
+
+    return true;
+#endif
+}
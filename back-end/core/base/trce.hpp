@@ -0,0 +1,39 @@
+#ifndef __ZX_TRACE_EVENTS_HPP__
+#define __ZX_TRACE_EVENTS_HPP__ 1
+
+#include "defs.hpp"
+
+//// SPANS ONLY EXIST WHEN BUILT WITH -DZX_TRACE (make TRACE=1), OTHERWISE THEY ARE NOTHING
+#if defined(ZX_TRACE)
+#define ZX_JOIN_(a, b)  a##b
+#define ZX_JOIN(a, b)   ZX_JOIN_(a, b)
+#define ZX_SPAN(label)  const zx::tr::span ZX_JOIN(zx_span_, __LINE__) {label}
+#define ZX_NAME(label)  zx::tr::name(label)
+#else
+#define ZX_SPAN(label)  do {} while (0)
+#define ZX_NAME(label)  do {} while (0)
+#endif
+
+namespace zx::tr
+{
+    //// per thread ring of complete events, the owner never waits - oldest overwritten
+    i64  now  (void) noexcept ;                         // nanoseconds since start
+    void push (const char*, const i64, const i64) noexcept ; // label (literal), begin, end
+    void name (const char*) noexcept ;                  // calling thread label (literal)
+    bool dump (const char*) noexcept ;                  // chrome / perfetto json, false when compiled out
+
+    //// BEGIN ON CONSTRUCTION, END ON SCOPE EXIT
+    struct span final {
+
+        const char *label {};
+        i64         begin {};
+
+        explicit span (const char* l) noexcept : label{l}, begin{now()} {}
+        ~span () noexcept { push(label, begin, now()); }
+
+        span (const span&) = delete;
+        span& operator= (const span&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __ZX_TRIPLE_BUFFER_HPP__
+#define __ZX_TRIPLE_BUFFER_HPP__ 1
+
+#include <atomic>
+#include "defs.hpp"
+
+namespace zx
+{
+    //// LOCK-FREE TRIPLE BUFFER - one writer, one reader, newest value wins
+    ////
+    //// writer: fill back(), publish()    - never waits, an unread slot is overwritten
+    //// reader: fetch() -> true, front()  - newest published slot, owned until next fetch
+    template <typename T>
+    struct triple final {
+
+        T slot[3] {};
+
+        T& back  (void) noexcept { return slot[write]; }
+        T& front (void) noexcept { return slot[read]; }
+
+        void publish (void) noexcept {
+            write = u08(middle.exchange(u08(write | fresh), std::memory_order_acq_rel) & index);
+        }
+
+        bool fetch (void) noexcept {
+            if (0 == (middle.load(std::memory_order_relaxed) & fresh)) return false;
+            read = u08(middle.exchange(read, std::memory_order_acq_rel) & index);
+            return true;
+        }
+
+      private:
+
+        static constexpr u08 index {3};
+        static constexpr u08 fresh {4};         // middle slot not read yet
+
+        std::atomic<u08> middle {1};
+        u08              write  {0};            // writer thread only
+        u08              read   {2};            // reader thread only
+    };
+}
+
+#endif
@@ -0,0 +1,213 @@
+#include <ctime>
+#include <mutex>
+
+#include "aggr.hpp"
+
+namespace core {
+
+    using zx::u32, zx::u64, zx::i64;
+
+    //// RING OF TIME BUCKETS - busy milliseconds per bucket
+    static constexpr u32 slots {30};
+    static constexpr i64 width[zx::ag::windows] { 10000, 120000, 2880000 }; // 10 s, 2 min, 48 min
+
+    struct ring final {
+        u32 busy[slots] {};
+        u64 sum  {0};      // busy milliseconds inside the ring
+        i64 head {0};      // newest bucket number
+    };
+
+    struct lot final {
+        zx::u08 busy {0};
+        zx::u16 zone {0};
+        bool    gone {false}; // removed by REMAP, id is never reused
+        i64     mark {0};  // settled up to (ms)
+        i64     born {0};  // table reset (ms), nothing is known before it
+        ring    win[zx::ag::windows] {};
+    };
+
+    static std::mutex           mutex {};
+    static std::vector<lot>     lots  {};
+    static std::vector<zx::u16> zones {}; // by lot id, kept across table resets
+}
+
+static core::i64 now (void) noexcept {
+    struct timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return core::i64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+//// drop buckets older than the window ending at bucket b
+static void roll (core::ring& r, const core::i64 b) noexcept {
+    if (b <= r.head) return;
+    const core::i64 first = (b - r.head > core::slots) ? b - core::slots : r.head;
+    for (core::i64 k = first + 1; k <= b; ++k) {
+        zx::u32& slot = r.busy[k % core::slots];
+        r.sum -= slot;
+        slot   = 0;
+    }
+    r.head = b;
+}
+
+//// account [mark, t) into every window - at most slots + 1 buckets per window
+static void settle (core::lot& l, const core::i64 t) noexcept {
+
+    for (zx::u32 w = 0; w < zx::ag::windows; ++w) {
+
+        core::ring&     r    = l.win[w];
+        const core::i64 span = core::width[w];
+        core::i64       from = l.mark;
+
+        if (t - from > span * core::slots) from = t - span * core::slots;
+
+        while (from < t) {
+            const core::i64 b   = from / span;
+            const core::i64 end = (b + 1) * span < t ? (b + 1) * span : t;
+            roll(r, b);
+            if (l.busy) {
+                r.busy[b % core::slots] += zx::u32(end - from);
+                r.sum                   += zx::u64(end - from);
+            }
+            from = end;
+        }
+
+        roll(r, t / span);
+    }
+
+    l.mark = t;
+}
+
+//// busy fraction of the covered part of each window
+static zx::ag::rates rate (const core::lot& l, const core::i64 t) noexcept {
+    zx::ag::rates out {};
+    for (zx::u32 w = 0; w < zx::ag::windows; ++w) {
+        const core::i64 span = core::width[w];
+        const core::i64 ring  = (core::slots - 1) * span + (t % span);
+        const core::i64 cover = (t - l.born) < ring ? (t - l.born) : ring;
+        out[w] = zx::f32(zx::f64(l.win[w].sum) / zx::f64(cover > 0 ? cover : 1));
+    }
+    return out;
+}
+
+//// append free lots up to count, born now
+static void fresh (const zx::u32 count) noexcept {
+
+    const core::i64 t = now();
+
+    for (zx::u32 i = zx::u32(core::lots.size()); i < count; ++i) {
+        core::lot l {};
+        l.zone = i < core::zones.size() ? core::zones[i] : zx::u16(0);
+        l.mark = t;
+        l.born = t;
+        for (zx::u32 w = 0; w < zx::ag::windows; ++w) l.win[w].head = t / core::width[w];
+        core::lots.push_back(l);
+    }
+}
+
+void
+zx::ag::size (const u32 count) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    core::lots.clear();
+
+    fresh(count);
+}
+
+void
+zx::ag::grow (const u32 count) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    if (count > core::lots.size()) fresh(count);
+}
+
+void
+zx::ag::drop (const u32 lot) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    if (lot < core::lots.size()) core::lots[lot].gone = true;
+}
+
+void
+zx::ag::push (const u32 lot, const u08 busy) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    if (lot >= core::lots.size()) return;
+
+    core::lot& l = core::lots[lot];
+
+    settle(l, now());
+    l.busy = busy;
+}
+
+bool
+zx::ag::zone (const u32 lot, const u16 zone) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    if (lot >= core::lots.size() or core::lots[lot].gone) return false;
+
+    if (lot >= core::zones.size()) core::zones.resize(lot + 1u, 0);
+
+    core::zones[lot]     = zone;
+    core::lots[lot].zone = zone;
+
+    return true;
+}
+
+std::vector<zx::ag::total>
+zx::ag::lots (void) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    const core::i64 t = now();
+
+    std::vector<total> out {};
+    out.reserve(core::lots.size());
+
+    for (u32 i = 0; i < core::lots.size(); ++i) {
+        core::lot& l = core::lots[i];
+        if (l.gone) continue;
+        settle(l, t);
+        out.push_back({ i, l.zone, rate(l, t) });
+    }
+
+    return out;
+}
+
+std::vector<zx::ag::total>
+zx::ag::zones (void) noexcept {
+
+    std::vector<total> out {};
+    std::vector<u32>   cnt {};
+
+    for (const total& l : lots()) {
+        if (l.zone >= out.size()) {
+            out.resize(l.zone + 1u);
+            cnt.resize(l.zone + 1u, 0);
+        }
+        out[l.zone].zone = l.zone;
+        cnt[l.zone]     += 1;
+        for (u32 w = 0; w < windows; ++w) out[l.zone].busy[w] += l.busy[w];
+    }
+
+    for (u32 z = 0; z < out.size(); ++z) {
+        out[z].zone = u16(z);
+        for (u32 w = 0; w < windows; ++w) out[z].busy[w] = cnt[z] ? out[z].busy[w] / f32(cnt[z]) : 0.0f;
+    }
+
+    return out;
+}
+
+zx::ag::rates
+zx::ag::site (void) noexcept {
+
+    rates out {};
+    u32   cnt {0};
+
+    for (const total& l : lots()) {
+        for (u32 w = 0; w < windows; ++w) out[w] += l.busy[w];
+        cnt += 1;
+    }
+
+    for (u32 w = 0; w < windows; ++w) out[w] = cnt ? out[w] / f32(cnt) : 0.0f;
+
+    return out;
+}
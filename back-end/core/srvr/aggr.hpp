@@ -0,0 +1,31 @@
+#ifndef __ZX_OCCUPANCY_AGGREGATES_HPP__
+#define __ZX_OCCUPANCY_AGGREGATES_HPP__ 1
+
+#include <array>
+#include <vector>
+#include "defs.hpp"
+
+namespace zx::ag
+{
+    constexpr u32 windows {3};                 // 5 minutes, 1 hour, 1 day
+
+    using rates = std::array<f32, ag::windows>; // busy fraction per window
+
+    struct total final {
+        u32   lot  {0};
+        u16   zone {0};
+        rates busy {};
+    };
+
+    void size (const u32) noexcept ;             // lot table changed, every lot starts free in the zone its id had
+    void grow (const u32) noexcept ;             // REMAP added lot ids, the others keep their history
+    void drop (const u32) noexcept ;             // REMAP removed the lot
+    void push (const u32, const u08) noexcept ;  // lot, busy
+    bool zone (const u32, const u16) noexcept ;  // lot, zone - false for a lot not in the table
+
+    std::vector<total> lots  (void) noexcept ;   // per lot
+    std::vector<total> zones (void) noexcept ;   // per zone (lot unused)
+    rates              site  (void) noexcept ;   // every lot
+}
+
+#endif
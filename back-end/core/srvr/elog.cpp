@@ -0,0 +1,259 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "elog.hpp"
+
+namespace core {
+
+    using zx::u64, zx::i64;
+
+    struct file final {
+        zx::u32          magic   {0x474F4C50}; // "PLOG"
+        zx::u32          version {1};
+        std::atomic<u64> count   {0};          // published records
+        u64              pad[6]  {};
+    };
+
+    static_assert(sizeof(file) == 64);
+
+    //// TIME INDEX - ONE MARK EVERY block RECORDS
+    struct mark final {
+        i64              stamp {0};  // first record of the block
+        std::vector<u64> busy  {};   // lot state before it, one bit per lot id
+    };
+
+    static constexpr u64 block {4096};
+    static constexpr u64 chunk {65536};       // file growth in records
+    static constexpr u64 most  {u64(1) << 26}; // reserved address space in records (1.5 GB)
+
+    static int                fd    {-1};
+    static file              *head  {nullptr};
+    static zx::lg::event     *data  {nullptr};
+    static u64                room  {0};       // records backed by the file
+    static std::vector<u64>   state {};        // writer lot state
+    static i64                last  {0};       // last stamp (monotonic)
+    static zx::u16            cam   {0};       // camera id of this instance
+    static std::mutex         mutex {};        // index
+    static std::vector<mark>  index {};
+}
+
+static void flip (std::vector<core::u64>& bits, const zx::lg::event& e) noexcept {
+    if (bits.size() <= core::u64(e.lot >> 6)) bits.resize(core::u64(e.lot >> 6) + 1, 0);
+    const core::u64 bit = core::u64(1) << (e.lot & 63);
+    if (e.busy) bits[e.lot >> 6] |= bit; else bits[e.lot >> 6] &= ~bit;
+}
+
+static bool test (const std::vector<core::u64>& bits, const zx::u32 lot) noexcept {
+    return lot >> 6 < bits.size() and (bits[lot >> 6] >> (lot & 63) & 1);
+}
+
+static bool grow (const core::u64 room) noexcept {
+    if (-1 == ftruncate(core::fd, off_t(sizeof(core::file) + room * sizeof(zx::lg::event)))) {
+        std::fprintf(stderr, "erro: registro de eventos sem espaco\n");
+        return false;
+    }
+    core::room = room;
+    return true;
+}
+
+//// first record with stamp >= t
+static core::u64 seek (const core::u64 count, const core::i64 t) noexcept {
+    const zx::lg::event *end = std::lower_bound(core::data, core::data + count, t,
+        [](const zx::lg::event& e, const core::i64 v) { return e.stamp < v; });
+    return core::u64(end - core::data);
+}
+
+zx::i64
+zx::lg::time (void) noexcept {
+    struct timespec ts {};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return i64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool
+zx::lg::init (const char* path, const u16 cam) noexcept {
+
+    if (-1 != core::fd) return true;
+
+    core::cam = cam;
+
+    core::fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    if (-1 == core::fd) {
+        std::fprintf(stderr, "erro: registro de eventos %s indisponivel\n", path);
+        return false;
+    }
+
+    struct stat st {};
+    fstat(core::fd, &st);
+
+    const bool fresh = u64(st.st_size) < sizeof(core::file);
+
+    if (fresh and not grow(core::chunk)) { close(core::fd); core::fd = -1; return false; }
+
+    void *map = mmap(nullptr, sizeof(core::file) + core::most * sizeof(event), PROT_READ | PROT_WRITE, MAP_SHARED, core::fd, 0);
+
+    if (MAP_FAILED == map) {
+        std::fprintf(stderr, "erro: falha ao mapear registro de eventos %s\n", path);
+        close(core::fd);
+        core::fd = -1;
+        return false;
+    }
+
+    core::head = fresh ? new (map) core::file {} : static_cast<core::file*>(map);
+    core::data = reinterpret_cast<event*>(static_cast<u08*>(map) + sizeof(core::file));
+
+    if (core::head->magic != core::file{}.magic) {
+        std::fprintf(stderr, "erro: registro de eventos %s invalido\n", path);
+        stop();
+        return false;
+    }
+
+    if (not fresh) core::room = (u64(st.st_size) - sizeof(core::file)) / sizeof(event);
+
+    //// REBUILD INDEX AND WRITER STATE
+    const u64 count = core::head->count.load(std::memory_order_acquire);
+
+    core::index.clear();
+    core::state.clear();
+
+    for (u64 i = 0; i < count; ++i) {
+        if (0 == i % core::block) core::index.push_back({ core::data[i].stamp, core::state });
+        flip(core::state, core::data[i]);
+    }
+
+    core::last = count ? core::data[count - 1].stamp : 0;
+
+    return true;
+}
+
+void
+zx::lg::stop (void) noexcept {
+
+    if (-1 == core::fd) return;
+
+    munmap(core::head, sizeof(core::file) + core::most * sizeof(event));
+    close(core::fd);
+
+    core::fd   = -1;
+    core::head = nullptr;
+    core::data = nullptr;
+    core::room = 0;
+
+    std::lock_guard<std::mutex> lock(core::mutex);
+    core::index.clear();
+}
+
+void
+zx::lg::push (const u32 lot, const u08 busy, const f32 score) noexcept {
+
+    if (nullptr == core::head) return;
+
+    if (lot > 0xFFFF) {
+        std::fprintf(stderr, "erro: vaga %u fora do registro de eventos\n", lot);
+        return;
+    }
+
+    const u64 n = core::head->count.load(std::memory_order_relaxed);
+
+    if (n >= core::most) return;
+    if (n >= core::room and not grow(core::room + core::chunk)) return;
+
+    const i64 now = time();
+    core::last = now > core::last ? now : core::last;
+
+    const event e { core::last, core::cam, u16(lot), busy, {}, score };
+
+    if (0 == n % core::block) {
+        core::mark m { e.stamp, core::state };
+        std::lock_guard<std::mutex> lock(core::mutex);
+        core::index.push_back(std::move(m));
+    }
+
+    core::data[n] = e;
+    flip(core::state, e);
+
+    core::head->count.store(n + 1, std::memory_order_release);
+}
+
+std::vector<zx::lg::event>
+zx::lg::span (const i64 from, const i64 to) noexcept {
+
+    if (nullptr == core::head or to <= from) return {};
+
+    const u64 count = core::head->count.load(std::memory_order_acquire);
+    const u64 first = seek(count, from);
+    const u64 limit = seek(count, to);
+
+    return { core::data + first, core::data + limit };
+}
+
+std::vector<zx::f32>
+zx::lg::rate (const i64 from, const i64 until) noexcept {
+
+    if (nullptr == core::head) return {};
+
+    const u64 count = core::head->count.load(std::memory_order_acquire);
+
+    //// NOTHING IS KNOWN PAST NOW - A WINDOW REACHING INTO THE FUTURE ENDS HERE
+    const i64 newest = count ? core::data[count - 1].stamp : from;
+    const i64 to     = std::min(until, std::max(time(), newest));
+
+    if (to <= from) return {};
+
+    //// STATE AT from - INDEX MARK + REPLAY INSIDE ITS BLOCK
+    core::mark m {};
+    u64        b = 0;
+    {
+        std::lock_guard<std::mutex> lock(core::mutex);
+        auto it = std::upper_bound(core::index.begin(), core::index.end(), from,
+            [](const i64 v, const core::mark& k) { return v < k.stamp; });
+        if (it != core::index.begin()) {
+            m = *(--it);
+            b = u64(it - core::index.begin()) * core::block;
+        }
+    }
+
+    const u64 first = seek(count, from);
+    const u64 limit = seek(count, to);
+
+    for (u64 i = b; i < first; ++i) flip(m.busy, core::data[i]);
+
+    //// BUSY TIME PER LOT
+    u32 lots = 0;
+    for (u32 l = 0; l < m.busy.size() * 64; ++l) if (test(m.busy, l)) lots = l + 1;
+    for (u64 i = first; i < limit; ++i) lots = core::data[i].lot + 1u > lots ? core::data[i].lot + 1u : lots;
+
+    std::vector<i64> since(lots, -1), spent(lots, 0);
+
+    for (u32 l = 0; l < lots; ++l)
+        if (test(m.busy, l)) since[l] = from;
+
+    for (u64 i = first; i < limit; ++i) {
+        const event& e = core::data[i];
+        if (e.busy and since[e.lot] < 0) {
+            since[e.lot] = e.stamp;
+        } else if (not e.busy and since[e.lot] >= 0) {
+            spent[e.lot] += e.stamp - since[e.lot];
+            since[e.lot]  = -1;
+        }
+    }
+
+    std::vector<f32> out(lots, 0.0f);
+
+    for (u32 l = 0; l < lots; ++l) {
+        if (since[l] >= 0) spent[l] += to - since[l];
+        out[l] = f32(f64(spent[l]) / f64(to - from));
+    }
+
+    return out;
+}
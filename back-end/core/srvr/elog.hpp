@@ -0,0 +1,30 @@
+#ifndef __ZX_OCCUPANCY_EVENT_LOG_HPP__
+#define __ZX_OCCUPANCY_EVENT_LOG_HPP__ 1
+
+#include <vector>
+#include "defs.hpp"
+
+namespace zx::lg
+{
+    struct event final {
+        i64 stamp {0};  // CLOCK_REALTIME microseconds, non decreasing
+        u16 cam   {0};
+        u16 lot   {0};
+        u08 busy  {0};
+        u08 pad[3]{};
+        f32 score {0};
+    };
+
+    static_assert(sizeof(event) == 24);
+
+    bool init (const char*, const u16) noexcept ; // open or create the log file, camera id of its events
+    void stop (void) noexcept ;
+    void push (const u32, const u08, const f32) noexcept ; // lot, busy, score - ids past 65535 reported and dropped
+
+    std::vector<event> span (const i64, const i64) noexcept ; // transitions in [from, to) microseconds
+    std::vector<f32>   rate (const i64, const i64) noexcept ; // busy fraction per lot in [from, to), to clamped to now
+
+    i64  time (void) noexcept ;         // now in log microseconds
+}
+
+#endif
@@ -0,0 +1,630 @@
+#include <asio.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+namespace core {
+
+    using asio::ip::tcp;
+    using text = std::shared_ptr<const std::string>;
+
+    //// ONE CAMERA LOT IN SITE UNITS
+    struct lot final {
+        zx::u32  id     {};
+        zx::u32  busy   {};
+        zx::f32  score  {};
+        zx::rf32 area   {};
+        zx::f32  pixels {};     // low res pixels of the lot, the nearer camera sees more
+    };
+
+    struct source final {
+        std::vector<lot> lots  {};
+        bool             up    {false};
+        bool             shown {false};     // up as last published
+    };
+
+    struct bay final {
+        zx::u32  id    {};      // site id, kept while some camera sees the bay
+        zx::u32  busy  {};
+        zx::f32  score {};
+        zx::rf32 area  {};
+        zx::u32  cam   {};      // camera that decided it
+        bool     stale {false}; // camera down, last known state
+    };
+
+    struct delta final {
+        zx::u64 seq  {};
+        text    body {};
+    };
+
+    //// DASHBOARD CONNECTION - shared by its session and the read that notices it leave
+    struct peer final {
+        tcp::socket        socket;
+        asio::steady_timer wait;
+        bool               gone {false};
+    };
+
+    static zx::ms::conf                      conf    {};
+    static std::unique_ptr<asio::io_context> context {};  // single io thread, no strands needed
+    static std::unique_ptr<asio::signal_set> signals {};
+    static std::vector<source>               sources {};
+    static std::vector<bay>                  bays    {};  // by id
+    static zx::u32                           next    {0}; // next site bay id
+    static zx::u64                           count   {0}; // table version, one per delta
+    static std::deque<delta>                 deltas  {};  // newest history deltas
+    static std::set<asio::steady_timer*>     waits   {};  // watchers idle on the newest delta
+
+    static constexpr std::size_t history {64};   // deltas kept, a watcher further behind gets a snapshot
+    static constexpr std::size_t limit   {4096}; // longest accepted command line
+    static constexpr std::size_t reply   {1u << 20}; // longest 'lots' reply
+    static constexpr std::chrono::seconds retry {2};
+    static constexpr std::chrono::milliseconds pause {100}; // between two failed accepts
+    static constexpr std::chrono::milliseconds least {1000}; // shortest answer deadline
+}
+
+namespace local {
+
+////////////////////////////
+//// CONFIGURATION FILE ////
+////////////////////////////
+static std::string
+trim (const std::string& s) noexcept {
+    const std::size_t start = s.find_first_not_of(" \t\r\n");
+    const std::size_t end   = s.find_last_not_of(" \t\r\n");
+    if (start == std::string::npos) return "";
+    return s.substr(start, end - start + 1);
+}
+
+//// whole value must be a number inside [min, max]
+static bool
+number (const std::string& value, const zx::f64 min, const zx::f64 max, zx::f64& out) noexcept {
+    char *end = nullptr;
+    out = std::strtod(value.c_str(), &end);
+    return not value.empty() and end and *end == '\0' and out >= min and out <= max;
+}
+
+//// host port x y w h
+static bool
+camera (const std::string& value, zx::ms::camera& cam) {
+    std::istringstream args(value);
+    zx::u32 port = 0;
+    if (not (args >> cam.host >> port >> cam.area.x >> cam.area.y >> cam.area.w >> cam.area.h)) return false;
+    cam.port = zx::u16(port);
+    return port > 0 and port < 65536 and cam.area.w > 0.0f and cam.area.h > 0.0f;
+}
+
+static bool
+apply (zx::ms::conf& c, const std::string& key, const std::string& value) {
+
+    zx::f64 v = 0.0;
+
+    if (key == "bind")   { c.bind = value; return not value.empty(); }
+    if (key == "port")   { if (not number(value, 1, 65535, v))  return false; c.port   = zx::u16(v); return true; }
+    if (key == "period") { if (not number(value, 50, 60000, v)) return false; c.period = zx::u32(v); return true; }
+    if (key == "merge")  { if (not number(value, 0.05, 1.0, v)) return false; c.merge  = zx::f32(v); return true; }
+
+    if (key == "camera") {
+        zx::ms::camera cam {};
+        if (not camera(value, cam)) return false;
+        c.cameras.push_back(cam);
+        return true;
+    }
+
+    return false;
+}
+
+////////////////////////////////
+//// MERGE - ONE SITE TABLE ////
+////////////////////////////////
+static zx::f32
+iou (const zx::rf32& a, const zx::rf32& b) noexcept {
+
+    const zx::f32 w = std::min(a.x + a.w, b.x + b.w) - std::max(a.x, b.x);
+    const zx::f32 h = std::min(a.y + a.h, b.y + b.h) - std::max(a.y, b.y);
+
+    if (w <= 0.0f or h <= 0.0f) return 0.0f;
+
+    return w * h / (a.w * a.h + b.w * b.h - w * h);
+}
+
+static std::string
+line (const core::bay& b) {
+    return std::format("BAY {} {} {:.3f} {:.1f} {:.1f} {:.1f} {:.1f} {} {}\n",
+        b.id, b.busy, b.score, b.area.x, b.area.y, b.area.w, b.area.h, b.cam, b.stale ? 1 : 0);
+}
+
+static std::string
+line (const std::size_t i) {
+    const zx::ms::camera& c = core::conf.cameras[i];
+    return std::format("CAMERA {} {} {} {}\n", i, c.host, c.port, core::sources[i].up ? 1 : 0);
+}
+
+//// snap - cameras and bays, then the version deltas continue from
+static std::string
+snapshot (void) {
+    std::string out {};
+    for (std::size_t i = 0; i < core::sources.size(); ++i) out += line(i);
+    for (const core::bay& b : core::bays) out += line(b);
+    return out + std::format("SNAP: OK {}\n", core::count);
+}
+
+static bool
+same (const core::bay& a, const core::bay& b) noexcept {
+    return a.busy == b.busy and a.stale == b.stale and a.cam == b.cam and
+           a.area.x == b.area.x and a.area.y == b.area.y and a.area.w == b.area.w and a.area.h == b.area.h;
+}
+
+//// cameras and bays that changed since the last table, shared by every watcher
+static void
+publish (const std::vector<core::bay>& last) {
+
+    std::string out {};
+
+    for (std::size_t i = 0; i < core::sources.size(); ++i) {
+        if (core::sources[i].up == core::sources[i].shown) continue;
+        core::sources[i].shown = core::sources[i].up;
+        out += line(i);
+    }
+
+    //// BOTH TABLES SORTED BY ID
+    std::size_t a = 0, b = 0;
+
+    while (a < last.size() or b < core::bays.size()) {
+        if (b == core::bays.size() or (a < last.size() and last[a].id < core::bays[b].id)) {
+            out += std::format("DROP {}\n", last[a++].id);
+        } else if (a == last.size() or core::bays[b].id < last[a].id) {
+            out += line(core::bays[b++]);
+        } else {
+            if (not same(last[a], core::bays[b])) out += line(core::bays[b]);
+            ++a, ++b;
+        }
+    }
+
+    if (out.empty()) return;
+
+    core::count += 1;
+    core::deltas.push_back({ core::count, std::make_shared<const std::string>(out + std::format("DELTA: OK {}\n", core::count)) });
+
+    if (core::deltas.size() > core::history) core::deltas.pop_front();
+
+    for (asio::steady_timer* t : core::waits) t->cancel();
+}
+
+//// nearest view first: a bay already taken by a nearer camera is the same bay seen again
+static void
+merge (void) {
+
+    struct seen final { const core::lot *lot {}; zx::u32 cam {}; };
+
+    std::vector<seen> all {};
+
+    for (std::size_t c = 0; c < core::sources.size(); ++c) {
+        if (not core::sources[c].up) continue;
+        for (const core::lot& l : core::sources[c].lots) all.push_back({ &l, zx::u32(c) });
+    }
+
+    std::stable_sort(all.begin(), all.end(), [] (const seen& a, const seen& b) { return a.lot->pixels > b.lot->pixels; });
+
+    const zx::f32      merge = core::conf.merge;
+    std::vector<bool>  kept(core::bays.size(), false);  // last bays that found their camera lot again
+    std::vector<core::bay> next {};
+
+    for (const seen& s : all) {
+
+        const zx::rf32& area = s.lot->area;
+
+        if (std::any_of(next.begin(), next.end(), [&] (const core::bay& b) { return iou(b.area, area) >= merge; })) continue;
+
+        //// SITE ID - THE LAST BAY OVERLAPPING MOST, A NEW ONE OTHERWISE
+        std::size_t best = core::bays.size();
+        zx::f32     most = merge;
+
+        for (std::size_t b = 0; b < core::bays.size(); ++b) {
+            const zx::f32 o = iou(core::bays[b].area, area);
+            if (not kept[b] and o >= most) best = b, most = o;
+        }
+
+        zx::u32 id = 0;
+        if (best < core::bays.size()) kept[best] = true, id = core::bays[best].id;
+        else                          id = core::next++;
+
+        next.push_back({ id, s.lot->busy, s.lot->score, area, s.cam, false });
+    }
+
+    //// BAYS OF A CAMERA THAT WENT DOWN STAY, FLAGGED, UNTIL IT COMES BACK
+    for (std::size_t b = 0; b < core::bays.size(); ++b) {
+        const core::bay& last = core::bays[b];
+        if (kept[b] or core::sources[last.cam].up) continue;
+        if (std::any_of(next.begin(), next.end(), [&] (const core::bay& n) { return iou(n.area, last.area) >= merge; })) continue;
+        next.push_back(last);
+        next.back().stale = true;
+    }
+
+    std::sort(next.begin(), next.end(), [] (const core::bay& a, const core::bay& b) { return a.id < b.id; });
+
+    std::swap(core::bays, next);
+
+    publish(next);
+}
+
+//// SIZE w h / LOT id busy score x y w h / LOTS: OK - low res pixels into site units
+static bool
+take (const std::size_t c, const std::string& reply) {
+
+    const zx::rf32&    site = core::conf.cameras[c].area;
+    std::istringstream in(reply);
+    std::string        row {}, name {};
+    zx::f32            sx = 0.0f, sy = 0.0f;
+    std::vector<core::lot> lots {};
+
+    while (std::getline(in, row)) {
+
+        std::istringstream args(row);
+        args >> name;
+
+        if (name == "SIZE") {
+            zx::f32 w = 0.0f, h = 0.0f;
+            if (not (args >> w >> h) or w <= 0.0f or h <= 0.0f) return false;
+            sx = site.w / w;
+            sy = site.h / h;
+        }
+
+        if (name == "LOT") {
+            core::lot l {};
+            zx::f32   x = 0.0f, y = 0.0f, w = 0.0f, h = 0.0f;
+            if (not (args >> l.id >> l.busy >> l.score >> x >> y >> w >> h) or 0.0f == sx) return false;
+            l.area   = { site.x + x * sx, site.y + y * sy, w * sx, h * sy };
+            l.pixels = w * h;
+            lots.push_back(l);
+        }
+    }
+
+    core::sources[c].lots = std::move(lots);
+
+    return true;
+}
+
+//// camera up or down, the table follows
+static void
+state (const std::size_t c, const bool up) {
+
+    const zx::ms::camera& cam = core::conf.cameras[c];
+
+    if (up != core::sources[c].up)
+        std::fprintf(stderr, "info: camera %s:%u %s\n", cam.host.c_str(), cam.port, up ? "no ar" : "fora do ar");
+
+    core::sources[c].up = up;
+    if (not up) core::sources[c].lots.clear();
+
+    merge();
+}
+
+/////////////////////////////////////
+//// POLLING - ONE PER CAMERA ///////
+/////////////////////////////////////
+static asio::awaitable<void>
+poll (const std::size_t c) {
+
+    const zx::ms::camera& cam = core::conf.cameras[c];
+    const auto            io  = co_await asio::this_coro::executor;
+
+    asio::steady_timer  wait(io);
+    core::tcp::resolver resolver(io);
+
+    //// AN INSTANCE THAT HANGS WITH THE CONNECTION OPEN IS DOWN AFTER THREE PERIODS
+    const std::chrono::milliseconds deadline = std::max(core::least, std::chrono::milliseconds(3 * core::conf.period));
+
+    for (;;) {
+        try {
+            core::tcp::socket  socket(io);
+            asio::steady_timer late(io);        // destroyed first, its handler never sees a dead socket
+
+            const auto arm = [&] {
+                late.expires_after(deadline);   // cancels the last arm
+                late.async_wait([&socket] (const asio::error_code& ec) { if (not ec) socket.close(); });
+            };
+
+            arm();
+            co_await asio::async_connect(socket, co_await resolver.async_resolve(cam.host, std::to_string(cam.port), asio::use_awaitable), asio::use_awaitable);
+
+            std::string input {};
+
+            for (;;) {
+                arm();
+
+                co_await asio::async_write(socket, asio::buffer("lots\n", 5), asio::use_awaitable);
+
+                const std::size_t n = co_await asio::async_read_until(socket, asio::dynamic_buffer(input, core::reply), "LOTS: OK\n", asio::use_awaitable);
+
+                late.cancel();
+
+                if (not take(c, input.substr(0, n))) break;
+                input.erase(0, n);
+
+                state(c, true);
+
+                wait.expires_after(std::chrono::milliseconds(core::conf.period));
+                co_await wait.async_wait(asio::use_awaitable);
+            }
+        } catch (const std::exception&) {
+            // refused, closed or garbled: down until the next connection answers
+        }
+
+        if (core::sources[c].up) state(c, false);
+
+        wait.expires_after(core::retry);
+        asio::error_code ec;
+        co_await wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+    }
+}
+
+/////////////////////////////////
+//// DASHBOARDS - SNAP, WATCH ///
+/////////////////////////////////
+
+//// input after 'watch' is dropped, the read stays pending only to notice the dashboard leave
+static asio::awaitable<void>
+drain (std::shared_ptr<core::peer> p) {
+
+    char             chunk[256];
+    asio::error_code ec;
+
+    while (not ec) co_await p->socket.async_read_some(asio::buffer(chunk), asio::redirect_error(asio::use_awaitable, ec));
+
+    p->gone = true;
+    p->wait.cancel();
+}
+
+//// after 'watch' the session only writes: newest deltas, or a snapshot when too far behind
+static asio::awaitable<void>
+watch (std::shared_ptr<core::peer> p, zx::u64 seen) {
+
+    core::tcp::socket& socket = p->socket;
+
+    asio::co_spawn(socket.get_executor(), drain(p), asio::detached);
+
+    for (;;) {
+
+        while (seen == core::count and not p->gone) {
+            core::waits.insert(&p->wait);
+            p->wait.expires_after(std::chrono::seconds(5));
+            asio::error_code ec;
+            co_await p->wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            core::waits.erase(&p->wait);
+        }
+
+        if (p->gone) co_return;
+
+        if (core::deltas.empty() or core::deltas.front().seq > seen + 1) {
+            const std::string all = snapshot();
+            seen = core::count;
+            co_await asio::async_write(socket, asio::buffer(all), asio::use_awaitable);
+            continue;
+        }
+
+        std::vector<core::text>        held {};    // alive until the write completes
+        std::vector<asio::const_buffer> data {};
+
+        for (const core::delta& d : core::deltas) {
+            if (d.seq <= seen) continue;
+            held.push_back(d.body);
+            data.push_back(asio::buffer(*d.body));
+        }
+
+        seen = core::count;
+
+        co_await asio::async_write(socket, data, asio::use_awaitable);
+    }
+}
+
+static asio::awaitable<void>
+session (core::tcp::socket connection) {
+
+    const auto         io     = connection.get_executor();
+    const auto         p      = std::make_shared<core::peer>(std::move(connection), asio::steady_timer(io));
+    core::tcp::socket& socket = p->socket;
+    std::string        input  {};
+    std::string        output {};
+    bool               open   {true};
+    bool               feed   {false};
+    zx::u64            since  {0};       // version of the snapshot 'watch' answered
+    char               chunk[1024];
+
+    try {
+        while (open and not feed) {
+
+            const std::size_t bytes = co_await socket.async_read_some(asio::buffer(chunk), asio::use_awaitable);
+
+            input.append(chunk, bytes);
+
+            std::size_t head = 0, tail = 0;
+
+            while (open and not feed and std::string::npos != (tail = input.find('\n', head))) {
+                const std::string cmd = trim(input.substr(head, tail - head));
+                head = tail + 1;
+                if (cmd.empty()) continue;
+
+                if      (cmd == "snap")  output += snapshot();
+                else if (cmd == "watch") output += snapshot(), feed = true, since = core::count;
+                else if (cmd == "quit")  output += "BYE\n", open = false;
+                else                     output += "CMD ERROR\n";
+            }
+
+            input.erase(0, head);
+
+            if (input.size() > core::limit) {
+                output += "CMD ERROR\n";
+                input.clear();
+            }
+
+            if (not output.empty()) {
+                co_await asio::async_write(socket, asio::buffer(output), asio::use_awaitable);
+                output.clear();
+            }
+        }
+
+        if (feed) co_await watch(p, since);
+
+    } catch (const std::exception&) {
+        // dashboard left
+    }
+
+    core::waits.erase(&p->wait);
+
+    asio::error_code ec;
+    socket.shutdown(core::tcp::socket::shutdown_both, ec);
+    socket.close(ec);
+}
+
+//// a failing accept (out of descriptors) waits before the next try instead of spinning
+static asio::awaitable<void>
+accept (core::tcp::acceptor acceptor) {
+
+    asio::steady_timer wait(acceptor.get_executor());
+    bool               fail {false};
+
+    for (;;) {
+
+        asio::error_code  ec;
+        core::tcp::socket socket = co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+
+        if (asio::error::operation_aborted == ec) co_return;
+
+        if (ec) {
+            if (not fail) std::fprintf(stderr, "erro: painel recusado (%s)\n", ec.message().c_str());
+            fail = true;
+            wait.expires_after(core::pause);
+            co_await wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            continue;
+        }
+
+        fail = false;
+        asio::co_spawn(*core::context, session(std::move(socket)), asio::detached);
+    }
+}
+
+}
+
+bool
+zx::ms::load (const char* path) noexcept {
+
+    std::ifstream file(path);
+
+    if (not file) {
+        std::fprintf(stderr, "erro: %s ausente\n", path);
+        return false;
+    }
+
+    conf        next {};
+    std::string line {};
+    u32         row  {0};
+
+    while (std::getline(file, line)) {
+
+        ++row;
+
+        const std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        line = local::trim(line);
+        if (line.empty()) continue;
+
+        const std::size_t eq = line.find('=');
+        const std::string key   = eq == std::string::npos ? line : local::trim(line.substr(0, eq));
+        const std::string value = eq == std::string::npos ? ""   : local::trim(line.substr(eq + 1));
+
+        conf probe = next;
+
+        if (eq == std::string::npos or not local::apply(probe, key, value)) {
+            std::fprintf(stderr, "erro: %s:%u entrada invalida '%s'\n", path, row, line.c_str());
+            continue;
+        }
+
+        next = probe;
+    }
+
+    if (next.cameras.empty()) {
+        std::fprintf(stderr, "erro: %s sem cameras\n", path);
+        return false;
+    }
+
+    core::conf = next;
+
+    return true;
+}
+
+bool
+zx::ms::init (void) noexcept {
+
+    if (core::context) return true;
+
+    core::context = std::make_unique<asio::io_context>(1);
+    core::sources.assign(core::conf.cameras.size(), {});
+    core::bays.clear();
+    core::deltas.clear();
+
+    try {
+        core::tcp::acceptor acceptor(*core::context, core::tcp::endpoint(asio::ip::make_address(core::conf.bind), core::conf.port));
+        asio::co_spawn(*core::context, local::accept(std::move(acceptor)), asio::detached);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "erro: servidor indisponivel em %s:%u (%s)\n", core::conf.bind.c_str(), core::conf.port, e.what());
+        core::context.reset();
+        return false;
+    }
+
+    for (std::size_t c = 0; c < core::sources.size(); ++c)
+        asio::co_spawn(*core::context, local::poll(c), asio::detached);
+
+    core::signals = std::make_unique<asio::signal_set>(*core::context, SIGINT, SIGTERM);
+    core::signals->async_wait([] (const asio::error_code&, int) { core::context->stop(); });
+
+    return true;
+}
+
+void
+zx::ms::run (void) noexcept {
+    if (core::context) core::context->run();
+}
+
+void
+zx::ms::stop (void) noexcept {
+
+    if (not core::context) return;
+
+    core::context->stop();
+    core::signals.reset();
+    core::context.reset();              // destroys pollers and sessions, closing their sockets
+    core::waits.clear();
+}
+
+const zx::ms::conf&
+zx::ms::data (void) noexcept {
+    return core::conf;
+}
+
+std::string
+zx::ms::feed (const std::size_t c, const std::string& reply) noexcept {
+
+    if (c >= core::conf.cameras.size()) return {};
+
+    if (core::sources.size() != core::conf.cameras.size()) core::sources.assign(core::conf.cameras.size(), {});
+
+    const u64 seen = core::count;
+
+    if (not reply.empty() and local::take(c, reply)) local::state(c, true);
+    else if (core::sources[c].up)                    local::state(c, false);
+
+    return core::count == seen ? std::string {} : *core::deltas.back().body;
+}
@@ -0,0 +1,44 @@
+#ifndef __ZX_SITE_AGGREGATOR_HPP__
+#define __ZX_SITE_AGGREGATOR_HPP__ 1
+
+#include <string>
+#include <vector>
+#include "defs.hpp"
+
+namespace zx::ms
+{
+    //// SITE AGGREGATOR - MANY PARK INSTANCES, ONE LOT TABLE
+    ////
+    //// every camera is polled with 'lots' from one io thread and its lots are mapped into
+    //// site units through the rectangle its frame covers. bays of two cameras overlapping
+    //// more than 'merge' are one site bay, decided by the camera that sees it largest.
+    //// dashboards ask 'snap' for the table or 'watch' for it followed by deltas, each
+    //// delta formatted once and shared by every watcher.
+    struct camera final {
+        std::string host {"127.0.0.1"};
+        u16         port {12345};
+        rf32        area {};            // site rectangle covered by the whole frame
+    };
+
+    //// key = value per line, # comments, one 'camera = host port x y w h' per instance
+    struct conf final {
+        std::string bind    {"0.0.0.0"};
+        u16         port    {12400};     // dashboards
+        u32         period  {500};       // ms between two polls of a camera
+        f32         merge   {0.3f};      // iou above which bays of two cameras are the same
+        std::vector<camera> cameras {};
+    };
+
+    bool load (const char*) noexcept ;  // false when the file is missing or lists no camera
+    bool init (void) noexcept ;         // server, pollers and signals, false when the port is taken
+    void run  (void) noexcept ;         // io on the caller until SIGINT / SIGTERM
+    void stop (void) noexcept ;
+
+    const conf& data (void) noexcept ;
+
+    //// OFFLINE - no sockets: a 'lots' reply of camera i goes through the polling path (empty or
+    //// garbled = camera down), the answer is the delta a watcher would receive, empty if unchanged
+    std::string feed (const std::size_t, const std::string&) noexcept ;
+}
+
+#endif
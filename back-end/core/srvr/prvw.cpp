@@ -0,0 +1,298 @@
+#include <asio.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jpeglib.h>
+
+#include "prvw.hpp"
+
+namespace core {
+
+    using asio::ip::tcp;
+    using clock = std::chrono::steady_clock;
+    using image = std::shared_ptr<const std::string>;
+
+    static std::unique_ptr<asio::io_context> context {};
+    static std::thread              server  {};     // http sessions
+    static std::thread              worker  {};     // jpeg encoder
+    static std::atomic<bool>        running {false};
+    static std::atomic<zx::u32>     viewers {0};
+    static clock::duration          frame   {};     // minimum interval between frames
+    static clock::time_point        taken   {};     // last accepted push
+
+    //// DROP-TO-LATEST SLOT - main thread -> encoder
+    static std::mutex               mutex   {};
+    static std::condition_variable  ready   {};
+    static std::vector<zx::u08>     slot    {};
+    static zx::su32                 size    {};
+    static bool                     fresh   {false};
+
+    //// LAST ENCODED FRAME - encoder -> sessions (io thread only)
+    static image                    jpeg    {};
+    static zx::u64                  count   {0};
+    static std::set<asio::steady_timer*> waits  {};
+
+    static constexpr std::chrono::milliseconds pause {100}; // between two failed accepts
+
+    //// ENCODER - worker thread only, static so a fault longjmp finds them intact
+    struct fault final {
+        jpeg_error_mgr base {};
+        std::jmp_buf   jump {};
+    };
+
+    static jpeg_compress_struct     codec   {};
+    static fault                    jerr    {};
+    static unsigned char           *out     {nullptr}; // libjpeg memory destination
+    static unsigned long            len     {0};
+}
+
+namespace local {
+
+//// default error_exit calls exit(): a bad frame would take the whole process down
+static void
+jpeg_fault (j_common_ptr info) noexcept {
+    std::longjmp(reinterpret_cast<core::fault*>(info->err)->jump, 1);
+}
+
+//// empty when libjpeg failed, the frame is skipped
+static std::string
+encode (const std::vector<zx::u08>& data, const zx::su32 size) {
+
+    jpeg_compress_struct& info = core::codec;
+
+    core::out = nullptr;
+    core::len = 0;
+
+    info.err = jpeg_std_error(&core::jerr.base);
+    core::jerr.base.error_exit = jpeg_fault;
+
+    if (setjmp(core::jerr.jump)) {
+        jpeg_destroy_compress(&info);
+        std::free(core::out);
+        core::out = nullptr;
+        std::fprintf(stderr, "erro: falha ao codificar o preview\n");
+        return {};
+    }
+
+    jpeg_create_compress(&info);
+    jpeg_mem_dest(&info, &core::out, &core::len);
+
+    info.image_width      = size.w;
+    info.image_height     = size.h;
+    info.input_components = 1;
+    info.in_color_space   = JCS_GRAYSCALE;
+
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, 70, TRUE);
+    info.dct_method = JDCT_IFAST;
+
+    jpeg_start_compress(&info, TRUE);
+
+    while (info.next_scanline < info.image_height) {
+        JSAMPROW line = const_cast<zx::u08*>(data.data()) + info.next_scanline * size.w;
+        jpeg_write_scanlines(&info, &line, 1);
+    }
+
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+
+    std::string jpeg(reinterpret_cast<const char*>(core::out), core::len);
+    std::free(core::out);
+    core::out = nullptr;
+
+    return jpeg;
+}
+
+static void
+encoder (void) {
+
+    std::vector<zx::u08> data {};
+    zx::su32             size {};
+
+    while (core::running) {
+        {
+            std::unique_lock<std::mutex> lock(core::mutex);
+            core::ready.wait(lock, [] { return core::fresh or not core::running; });
+            if (not core::running) return;
+            data.swap(core::slot);
+            size        = core::size;
+            core::fresh = false;
+        }
+
+        auto jpeg = std::make_shared<const std::string>(encode(data, size));
+
+        if (jpeg->empty()) continue;
+
+        //// HAND OVER TO THE IO THREAD AND WAKE EVERY SESSION
+        asio::post(*core::context, [jpeg] {
+            core::jpeg   = jpeg;
+            core::count += 1;
+            for (asio::steady_timer* t : core::waits) t->cancel();
+        });
+    }
+}
+
+static asio::awaitable<void>
+viewer (core::tcp::socket socket) {
+
+    asio::steady_timer wait(socket.get_executor());
+    zx::u64            seen {0};
+    std::string        request {};
+    bool               counted {false};
+
+    try {
+        //// REQUEST HEADER - CONTENT IGNORED, A HALF OPEN CONNECTION STARTS NO ENCODING
+        co_await asio::async_read_until(socket, asio::dynamic_buffer(request, 8192), "\r\n\r\n", asio::use_awaitable);
+
+        core::viewers += 1;
+        counted        = true;
+
+        const std::string head =
+            "HTTP/1.0 200 OK\r\n"
+            "Cache-Control: no-cache\r\n"
+            "Connection: close\r\n"
+            "Content-Type: multipart/x-mixed-replace; boundary=park\r\n\r\n";
+
+        co_await asio::async_write(socket, asio::buffer(head), asio::use_awaitable);
+
+        for (;;) {
+
+            while (seen == core::count) {
+                core::waits.insert(&wait);
+                wait.expires_after(std::chrono::seconds(5));
+                asio::error_code ec;
+                co_await wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+                core::waits.erase(&wait);
+            }
+
+            seen = core::count;
+
+            const core::image jpeg = core::jpeg;
+            const std::string part = std::format("--park\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n", jpeg->size());
+
+            const std::array<asio::const_buffer, 3> data {
+                asio::buffer(part), asio::buffer(*jpeg), asio::buffer("\r\n", 2)
+            };
+
+            co_await asio::async_write(socket, data, asio::use_awaitable);
+        }
+    } catch (const std::exception&) {
+        // viewer left
+    }
+
+    core::waits.erase(&wait);
+    if (counted) core::viewers -= 1;
+}
+
+//// a failing accept (out of descriptors) waits before the next try instead of spinning
+static asio::awaitable<void>
+accept (core::tcp::acceptor acceptor) {
+
+    asio::steady_timer wait(acceptor.get_executor());
+    bool               fail {false};
+
+    while (core::running) {
+
+        asio::error_code  ec;
+        core::tcp::socket socket = co_await acceptor.async_accept(asio::redirect_error(asio::use_awaitable, ec));
+
+        if (asio::error::operation_aborted == ec) co_return;
+
+        if (ec) {
+            if (not fail) std::fprintf(stderr, "erro: preview recusado (%s)\n", ec.message().c_str());
+            fail = true;
+            wait.expires_after(core::pause);
+            co_await wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            continue;
+        }
+
+        fail = false;
+        asio::co_spawn(*core::context, viewer(std::move(socket)), asio::detached);
+    }
+}
+
+}
+
+bool
+zx::pv::init (const char* bind, const u16 port, const u32 rate) noexcept {
+
+    if (core::running) return true;
+
+    core::context = std::make_unique<asio::io_context>(1); // single io thread, no strands needed
+    core::frame   = std::chrono::duration_cast<core::clock::duration>(std::chrono::seconds(1)) / (rate ? rate : 1);
+
+    try {
+        core::tcp::acceptor acceptor(*core::context, core::tcp::endpoint(asio::ip::make_address(bind), port));
+        core::running = true;
+        asio::co_spawn(*core::context, local::accept(std::move(acceptor)), asio::detached);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "erro: preview indisponivel em %s:%u (%s)\n", bind, port, e.what());
+        core::context.reset();
+        return false;
+    }
+
+    core::server = std::thread([] { core::context->run(); });
+    core::worker = std::thread(local::encoder);
+
+    return true;
+}
+
+void
+zx::pv::stop (void) noexcept {
+
+    if (not core::running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(core::mutex);
+        core::running = false;
+    }
+
+    core::ready.notify_all();
+    core::context->stop();
+
+    if (core::worker.joinable()) core::worker.join();
+    if (core::server.joinable()) core::server.join();
+
+    core::waits.clear();
+    core::context.reset();
+    core::jpeg.reset();
+    core::viewers = 0;
+}
+
+void
+zx::pv::push (const view& frame) noexcept {
+
+    if (0 == core::viewers.load(std::memory_order_relaxed)) return;
+
+    const core::clock::time_point now = core::clock::now();
+
+    if (now - core::taken < core::frame) return;
+
+    core::taken = now;
+
+    {
+        std::lock_guard<std::mutex> lock(core::mutex);
+
+        core::slot.resize(u64(frame.width) * frame.height);
+
+        for (u32 y = 0; y < frame.height; ++y)
+            std::memcpy(core::slot.data() + u64(y) * frame.width, frame.row(y), frame.width);
+
+        core::size  = { frame.width, frame.height };
+        core::fresh = true;
+    }
+
+    core::ready.notify_one();
+}
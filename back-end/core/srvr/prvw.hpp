@@ -0,0 +1,13 @@
+#ifndef __ZX_MJPEG_PREVIEW_HPP__
+#define __ZX_MJPEG_PREVIEW_HPP__ 1
+
+#include "defs.hpp"
+
+namespace zx::pv
+{
+    bool init (const char*, const u16, const u32) noexcept ; // bind address, port, max frames per second
+    void stop (void) noexcept ;
+    void push (const view&) noexcept ;                       // no-op without viewers
+}
+
+#endif
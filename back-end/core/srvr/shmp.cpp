@@ -0,0 +1,113 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+
+#include "shmp.hpp"
+
+namespace core {
+    static std::string   name {};
+    static zx::u08      *base {nullptr};
+    static zx::u64       size {0};
+    static zx::sm::head *head {nullptr};
+}
+
+bool
+zx::sm::init (const char* name, const su32 frame) noexcept {
+
+    if (nullptr != core::base) return true;
+
+    const u64 plane = (u64(frame.w) * frame.h + 63) & ~u64(63);
+    const u64 first = (sizeof(sm::head) + 63) & ~u64(63);
+    const u64 total = first + 2 * plane;
+
+    const int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+
+    if (-1 == fd) {
+        std::fprintf(stderr, "erro: memoria compartilhada %s indisponivel\n", name);
+        return false;
+    }
+
+    if (-1 == ftruncate(fd, off_t(total))) {
+        std::fprintf(stderr, "erro: memoria compartilhada %s sem espaco\n", name);
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+
+    if (MAP_FAILED == data) {
+        std::fprintf(stderr, "erro: falha ao mapear memoria compartilhada %s\n", name);
+        return false;
+    }
+
+    core::name = name;
+    core::base = static_cast<u08*>(data);
+    core::size = total;
+    core::head = new (data) sm::head {};
+
+    core::head->width   = frame.w;
+    core::head->height  = frame.h;
+    core::head->image   = first;
+    core::head->overlay = first + plane;
+
+    return true;
+}
+
+void
+zx::sm::stop (void) noexcept {
+
+    if (nullptr == core::base) return;
+
+    core::head->seq.store(sm::closed, std::memory_order_release); // mapped readers stop and re-open
+
+    munmap(core::base, core::size);
+    shm_unlink(core::name.c_str());
+
+    core::base = nullptr;
+    core::head = nullptr;
+    core::size = 0;
+}
+
+void
+zx::sm::push (const view& image, const view& overlay, const std::vector<match>& lots) noexcept {
+
+    sm::head *seg = core::head;
+
+    if (nullptr == seg) return;
+
+    const u32 wd = image.width  < seg->width  ? image.width  : seg->width;
+    const u32 ht = image.height < seg->height ? image.height : seg->height;
+    const u32 nl = lots.size()  < sm::most    ? u32(lots.size()) : sm::most;
+
+    struct timespec ts {};
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    //// SEQLOCK - WRITER SECTION
+    const u64 seq = seg->seq.load(std::memory_order_relaxed);
+    seg->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    u08 *dst = core::base + seg->image;
+    u08 *ovl = core::base + seg->overlay;
+
+    for (u32 y = 0; y < ht; ++y) {
+        std::memcpy(dst + u64(y) * seg->width, image.row(y),   wd);
+        std::memcpy(ovl + u64(y) * seg->width, overlay.row(y), wd);
+    }
+
+    std::memcpy(seg->lots, lots.data(), nl * sizeof(match));
+
+    seg->count  = nl;
+    seg->frame += 1;
+    seg->stamp  = i64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+
+    seg->seq.store(seq + 2, std::memory_order_release);
+}
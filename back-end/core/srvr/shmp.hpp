@@ -0,0 +1,58 @@
+#ifndef __ZX_SHARED_MEMORY_PUBLISHER_HPP__
+#define __ZX_SHARED_MEMORY_PUBLISHER_HPP__ 1
+
+#include <atomic>
+#include <vector>
+#include "defs.hpp"
+
+namespace zx::sm
+{
+    constexpr u32 magic   {0x4B524150}; // "PARK"
+    constexpr u32 version {2};          // 2: match.id
+    constexpr u32 most    {256};        // lot table capacity
+    constexpr u64 closed  {~u64(0)};    // terminal seq: segment unlinked, open it again by name
+
+    //// SEGMENT LAYOUT - head, then image and overlay at the given offsets
+    ////
+    //// reader: s0 = seq (acquire), closed -> re-open, odd -> retry
+    ////         copy what is needed
+    ////         fence (acquire), s1 = seq, s0 != s1 -> retry
+    ////
+    //// a reload that changes the frame size unlinks the segment and creates a new one;
+    //// the old one is left with seq = closed, which never advances again
+    struct head final {
+        u32              magic   {sm::magic};
+        u32              version {sm::version};
+        std::atomic<u64> seq     {0};   // odd while the writer is inside, closed once unlinked
+        u64              frame   {0};   // published frames
+        i64              stamp   {0};   // CLOCK_REALTIME microseconds
+        u32              width   {0};   // low res frame
+        u32              height  {0};
+        u32              count   {0};   // valid entries in lots
+        u32              pad     {0};
+        u64              image   {0};   // offset of the frame before overlay
+        u64              overlay {0};   // offset of the frame with lot overlay
+        match            lots[sm::most] {};
+    };
+
+    static_assert(std::atomic<u64>::is_always_lock_free);
+
+    bool init (const char*, const su32) noexcept ; // segment name (/park), frame size
+    void stop (void) noexcept ;
+    void push (const view&, const view&, const std::vector<match>&) noexcept ; // image, overlay, lots
+
+    //// wait-free for the writer, readers retry while it is inside - false once closed
+    template <typename F>
+    bool peek (const head& seg, F&& read) noexcept {
+        for (;;) {
+            const u64 s0 = seg.seq.load(std::memory_order_acquire);
+            if (sm::closed == s0) return false;
+            if (s0 & 1) continue;
+            read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s0 == seg.seq.load(std::memory_order_relaxed)) return true;
+        }
+    }
+}
+
+#endif
@@ -1,51 +1,151 @@
 
+
 #include <asio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
 #include "srvr.hpp"
+#include "clck.hpp"
+#include "elog.hpp"
+#include "aggr.hpp"
+#include "heap.hpp"
+#include "trce.hpp"
 
 namespace core {
 
     using asio::ip::tcp;
 
-    static asio::io_context  context  {};
-    static tcp::acceptor*    acceptor {nullptr};
-    static tcp::socket*      socket   {nullptr};
-    static std::thread       thread   {};
-    static std::atomic<bool> running  {false};
-    static asio::streambuf   buffer   {};
-    static zx::sv::cmds      command  {};
-    static std::vector<zx::match> block {};
+    static std::unique_ptr<asio::io_context> context {};
+    static std::thread              thread   {};
+    static std::atomic<bool>        running  {false};
+    static std::mutex               mutex    {};     // queue and block
+    static std::deque<zx::sv::cmds> queue    {};     // commands for the main loop
+    static zx::sv::cmds             command  {};     // last command taken by comm
+    static std::vector<zx::match>   block    {};
+    static zx::su32                 lower    {};     // low res size of block
+    static constexpr std::size_t    limit    {4096}; // longest accepted line
+    static constexpr std::chrono::milliseconds pause {100}; // between two failed accepts
 }
 
 namespace local {
 
-static void start_accept(void);
-static void start_read(void);
+static void post (const zx::sv::scmd cmd, const zx::ru32 area = {}) {
+    std::lock_guard<std::mutex> lock(core::mutex);
+    core::queue.push_back({ true, cmd, area });
+}
 
 static std::string handle_get(void)    {
-    core::command.update = true;
-    core::command.command = zx::sv::scmd::GET;
+    post(zx::sv::scmd::GET);
     return "GET: OK\n";
 }
 
 static std::string handle_update(void) {
-    core::command.update = true;
-    core::command.command = zx::sv::scmd::UPDATE;
+    post(zx::sv::scmd::UPDATE);
     return "UPDATE: OK \n";
 }
 
 static std::string handle_quit(void) {
-    core::command.update = true;
-    core::command.command = zx::sv::scmd::QUIT;
+    post(zx::sv::scmd::QUIT);
     return "BYE\n";
 }
 
 static std::string handle_check(void) {
-    core::command.update = true;
-    core::command.command = zx::sv::scmd::CHECK;
+    post(zx::sv::scmd::CHECK);
     return "CHECK: OK\n";
 }
 
+static std::string handle_reload(void) {
+    post(zx::sv::scmd::RELOAD);
+    return "RELOAD: OK\n";
+}
+
+static std::string handle_trace(void) {
+    post(zx::sv::scmd::TRACE);
+    return "TRACE: OK\n";
+}
+
+//// mem - resident bytes, arena used and reserved
+static std::string handle_mem(void) {
+    return std::format("MEM: {} {} {}\n", zx::mm::rss(), zx::mm::used(), zx::mm::size());
+}
+
+static std::string handle_rate(void) {
+    return std::format("RATE: {:.1f} {}\n", zx::ck::rate(), zx::ck::step());
+}
+
+//// remap [x y w h] - low res region, none = free lots whose markers faded
+static std::string handle_remap(std::istringstream& args) {
+    zx::ru32 area {};
+    if (args >> area.x and not (args >> area.y >> area.w >> area.h and area.w and area.h)) return "REMAP: ERROR\n";
+    post(zx::sv::scmd::REMAP, area);
+    return "REMAP: OK\n";
+}
+
+//// lots - current lots, low res pixels (site aggregator snapshot)
+static std::string handle_lots(void) {
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    std::string out = std::format("SIZE {} {}\n", core::lower.w, core::lower.h);
+    for (const zx::match& m : core::block)
+        out += std::format("LOT {} {} {:.3f} {} {} {} {}\n", m.id, m.busy, m.score, m.area.x, m.area.y, m.area.w, m.area.h);
+
+    return out + "LOTS: OK\n";
+}
+
+//// log <from> <to> - transitions, unix seconds
+static std::string handle_log(std::istringstream& args) {
+    zx::i64 from = 0, to = 0;
+    if (not (args >> from >> to)) return "LOG: ERROR\n";
+
+    std::string out {};
+    for (const zx::lg::event& e : zx::lg::span(from * 1000000, to * 1000000))
+        out += std::format("EVENT {} {} {} {} {:.3f}\n", e.stamp, e.cam, e.lot, e.busy, e.score);
+
+    return out + "LOG: OK\n";
+}
+
+//// occ <from> <to> - busy fraction per lot, unix seconds
+static std::string handle_occ(std::istringstream& args) {
+    zx::i64 from = 0, to = 0;
+    if (not (args >> from >> to)) return "OCC: ERROR\n";
+
+    std::string out {};
+    const std::vector<zx::f32> rate = zx::lg::rate(from * 1000000, to * 1000000);
+    for (std::size_t l = 0; l < rate.size(); ++l)
+        out += std::format("LOT {} {:.4f}\n", l, rate[l]);
+
+    return out + "OCC: OK\n";
+}
+
+//// aggr - busy fraction over 5 min, 1 hour and 1 day
+static std::string handle_aggr(void) {
+    std::string out {};
+
+    for (const zx::ag::total& l : zx::ag::lots())
+        out += std::format("LOT {} {} {:.4f} {:.4f} {:.4f}\n", l.lot, l.zone, l.busy[0], l.busy[1], l.busy[2]);
+
+    for (const zx::ag::total& z : zx::ag::zones())
+        out += std::format("ZONE {} {:.4f} {:.4f} {:.4f}\n", z.zone, z.busy[0], z.busy[1], z.busy[2]);
+
+    const zx::ag::rates site = zx::ag::site();
+
+    return out + std::format("SITE {:.4f} {:.4f} {:.4f}\nAGGR: OK\n", site[0], site[1], site[2]);
+}
+
+//// zone <lot> <zone> - the lot must be in the table, its zone outlives UPDATE
+static std::string handle_zone(std::istringstream& args) {
+    zx::u32 lot = 0, zone = 0;
+    if (not (args >> lot >> zone) or zone > 0xFFFF) return "ZONE: ERROR\n";
+    if (not zx::ag::zone(lot, zx::u16(zone)))       return "ZONE: ERROR\n";
+    return "ZONE: OK\n";
+}
+
 static std::string
 trim(const std::string& s) {
     auto start = s.find_first_not_of(" \r\n\t");
@@ -54,111 +154,134 @@ trim(const std::string& s) {
     return s.substr(start, end - start + 1);
 }
 
-static void
-command (const std::string& cmd) {
-
-    std::string response {};
-
-    if (cmd == "get") {
-        response = handle_get();
-    } else if (cmd == "update") {
-        response = handle_update();
-    } else if (cmd == "check") {
-        response = handle_check();
-    } else if (cmd == "quit") {
-        response = handle_quit();
-        asio::async_write(*core::socket, asio::buffer(response), [](const asio::error_code&, std::size_t) {});
-        core::socket->close();
-        delete core::socket;
-        core::socket = nullptr;
-        start_accept();
-        return;
-    } else {
-        core::command.update = false;
-        core::command.command = zx::sv::scmd::ERROR;
-        response = "CMD ERROR\n";
+//// one line -> one response, open is cleared by quit
+static std::string
+command (const std::string& cmd, bool& open) {
+
+    if (cmd == "get")    return handle_get();
+    if (cmd == "update") return handle_update();
+    if (cmd == "check")  return handle_check();
+    if (cmd == "rate")   return handle_rate();
+    if (cmd == "aggr")   return handle_aggr();
+    if (cmd == "reload") return handle_reload();
+    if (cmd == "trace")  return handle_trace();
+    if (cmd == "mem")    return handle_mem();
+    if (cmd == "lots")   return handle_lots();
+
+    if (cmd == "quit") {
+        open = false;
+        return handle_quit();
     }
 
-    asio::async_write(*core::socket, asio::buffer(response),
-                      [](const asio::error_code& ec, std::size_t) {
-                          if (ec) {
-                              core::command.update  = true;
-                              core::command.command = zx::sv::scmd::ERROR;
-                          }
-                      });
+    //// COMMANDS WITH ARGUMENTS
+    std::istringstream args(cmd);
+    std::string        name {};
+    args >> name;
+
+    if (name == "remap") return handle_remap(args);
+    if (name == "log")   return handle_log(args);
+    if (name == "occ")   return handle_occ(args);
+    if (name == "zone")  return handle_zone(args);
+
+    post(zx::sv::scmd::ERROR);
+    return "CMD ERROR\n";
 }
 
-static void
-on_read (const asio::error_code& ec, std::size_t bytes) {
+//// one coroutine per connection, running on its own strand
+static asio::awaitable<void>
+session (core::tcp::socket socket) {
 
-    (void) bytes;
+    std::string input  {};
+    std::string output {};              // batched responses, owned until the write completes
+    bool        open   {true};
+    char        chunk[1024];
 
-    if (!ec) {
-        std::istream is(&core::buffer);
-        std::string line;
-        std::getline(is, line);
+    try {
+        while (open) {
 
-        line = trim(line);
+            const std::size_t bytes = co_await socket.async_read_some(asio::buffer(chunk), asio::use_awaitable);
 
-        if (!line.empty()) {
-            command(line);
-        }
+            input.append(chunk, bytes);
 
-        if (core::socket && core::socket->is_open()) {
-            start_read();
-        }
-    } else {
-        core::command.update = true;
-        core::command.command = zx::sv::scmd::ERROR;
-        if (core::socket) {
-            core::socket->close();
-            delete core::socket;
-            core::socket = nullptr;
+            //// PIPELINE - EVERY COMPLETE LINE IN THE BUFFER
+            std::size_t head = 0, tail = 0;
+
+            while (open and std::string::npos != (tail = input.find('\n', head))) {
+                const std::string line = trim(input.substr(head, tail - head));
+                head = tail + 1;
+                if (line.empty()) continue;
+                ZX_SPAN("request");
+                output += command(line, open);
+            }
+
+            input.erase(0, head);
+
+            if (input.size() > core::limit) {
+                post(zx::sv::scmd::ERROR);
+                output += "CMD ERROR\n";
+                input.clear();
+            }
+
+            if (not output.empty()) {
+                co_await asio::async_write(socket, asio::buffer(output), asio::use_awaitable);
+                output.clear();
+            }
         }
-        start_accept();
+    } catch (const std::exception&) {
+        post(zx::sv::scmd::ERROR);      // disconnected or failed write
     }
-}
 
-static void
-start_read (void) {
-    asio::async_read_until(*core::socket, core::buffer, '\n',
-                           [](const asio::error_code& ec, std::size_t bytes) {
-                               on_read(ec, bytes);
-                           });
+    asio::error_code ec;
+    socket.shutdown(core::tcp::socket::shutdown_both, ec);
+    socket.close(ec);
 }
 
-static void
-on_accept (const asio::error_code& ec, core::tcp::socket socket) {
-    if (!ec) {
-        core::command.update = true;
-        core::command.command = zx::sv::scmd::CLIENT;
-        core::socket = new core::tcp::socket(std::move(socket));
-        start_read();
-    } else {
-        core::command.update = true;
-        core::command.command = zx::sv::scmd::ERROR;
-        start_accept();
-    }
-}
+//// a failing accept (out of descriptors) waits before the next try, no spin nor ERROR flood
+static asio::awaitable<void>
+listen (core::tcp::acceptor acceptor) {
 
-static void
-start_accept (void) {
-    core::acceptor->async_accept(
-        [](const asio::error_code& ec, core::tcp::socket socket) {
-            on_accept(ec, std::move(socket));
-        });
+    asio::steady_timer wait(acceptor.get_executor());
+    bool               fail {false};
+
+    while (core::running) {
+
+        asio::error_code  ec;
+        core::tcp::socket socket = co_await acceptor.async_accept(asio::make_strand(*core::context), asio::redirect_error(asio::use_awaitable, ec));
+
+        if (asio::error::operation_aborted == ec) co_return;
+
+        if (ec) {
+            if (not fail) std::fprintf(stderr, "erro: conexao recusada (%s)\n", ec.message().c_str());
+            fail = true;
+            wait.expires_after(core::pause);
+            co_await wait.async_wait(asio::redirect_error(asio::use_awaitable, ec));
+            continue;
+        }
+
+        fail = false;
+        post(zx::sv::scmd::CLIENT);
+        asio::co_spawn(socket.get_executor(), session(std::move(socket)), asio::detached);
+    }
 }
 
 static void
-start_server (unsigned short port) {
+start_server (const char* bind, unsigned short port) {
     if (core::running) return;
 
-    core::running  = true;
-    core::acceptor = new core::tcp::acceptor(core::context, core::tcp::endpoint(core::tcp::v4(), port));
+    core::context = std::make_unique<asio::io_context>();
 
-    start_accept();
+    try {
+        const core::tcp::endpoint endpoint(asio::ip::make_address(bind), port);
+        core::tcp::acceptor acceptor(*core::context, endpoint);
+        core::running = true;
+        asio::co_spawn(*core::context, listen(std::move(acceptor)), asio::detached);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "erro: servidor indisponivel em %s:%u (%s)\n", bind, port, e.what());
+        core::context.reset();
+        return;
+    }
 
-    core::thread = std::thread([] { core::context.run(); });
+    core::thread = std::thread([] { ZX_NAME("server"); core::context->run(); });
 }
 
 static void
@@ -167,26 +290,12 @@ stop_server (void) {
 
     core::running = false;
 
-    if (nullptr != core::acceptor) {
-        core::acceptor->cancel();
-        core::acceptor->close();
-
-        if (nullptr != core::socket) {
-            core::socket->cancel();
-            core::socket->close();
-
-            delete core::socket;
-            core::socket = nullptr;
-        }
-
-        delete core::acceptor;
-        core::acceptor = nullptr;
-    }
-
-    core::context.stop();
+    core::context->stop();
 
     if (core::thread.joinable())
         core::thread.join();
+
+    core::context.reset();              // destroys pending sessions and closes their sockets
 }
 
 }
@@ -197,9 +306,9 @@ zx::sv::proc(void) noexcept {
 }
 
 void
-zx::sv::init(void) noexcept {
+zx::sv::init(const char* bind, const u16 port) noexcept {
     core::command.update = false;
-    local::start_server(12345);
+    local::start_server(bind, port);
 }
 
 void
@@ -215,13 +324,23 @@ zx::sv::info (void) noexcept {
 
 bool
 zx::sv::comm (void) noexcept {
-    const bool cmd = core::command.update;
-    core::command.update = false;
-    return cmd;
+    std::lock_guard<std::mutex> lock(core::mutex);
+
+    if (core::queue.empty()) {
+        core::command.update = false;
+        return false;
+    }
+
+    core::command = core::queue.front();
+    core::queue.pop_front();
+
+    return core::command.update;
 }
 
 void
-zx::sv::push (const std::vector<zx::match>& data) noexcept {
+zx::sv::push (const std::vector<zx::match>& data, const su32 size) noexcept {
+    std::lock_guard<std::mutex> lock(core::mutex);
     core::block.clear();
     core::block = data;
+    core::lower = size;
 }
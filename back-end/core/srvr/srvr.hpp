@@ -16,20 +16,23 @@ namespace zx::sv {
         ERROR  = 5,
         CLIENT = 6,
         CHECK  = 7,
-        NONE   = 8
+        NONE   = 8,
+        RELOAD = 9,
+        TRACE  = 10
     };
 
     struct cmds final {
         bool update  {false};
         scmd command {};
+        ru32 area    {};        // REMAP region (low res), empty = faded free lots
     };
 
-    void init (void) noexcept ;
+    void init (const char*, const u16) noexcept ; // bind address, port
     void stop (void) noexcept ;
     void proc (void) noexcept ;
 
-    bool comm (void) noexcept ;
-    void push (const std::vector<zx::match>&) noexcept ;
+    bool comm (void) noexcept ;                   // take next queued command
+    void push (const std::vector<zx::match>&, const su32) noexcept ; // lots, low res size ('lots' snapshot)
     cmds info (void) noexcept ;
 }
 
@@ -6,18 +6,48 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <cassert>
+#include <csetjmp>
+#include <cstdio>
 #include <cstring>
 #include <string>
+#include <jpeglib.h>
 #include "defs.hpp"
 #include "drvr.hpp"
+#include "trce.hpp"
 
 namespace core {
     static zx::i32         fd      {};
     static zx::u32         bpline  {};
     static zx::u32         nbuffer {};
     static zx::wc::buffer *buffers {};
-    static zx::graph       graph   {}; // GRAYSCALE
-    static zx::frame       frame   {}; // YUYVIMAGE
+    static zx::su32        gray    {}; // gray size after link (caller buffers)
+    static zx::su32        frame   {}; // camera frame size
+    static zx::wc::mode    mode    {}; // NEGOTIATED MODE
+    static zx::wc::pixel   pixel   {}; // CAPTURE FORMAT
+    static zx::u32         scale   {1};// MJPG DCT SCALE / YUYV DECIMATION 1/scale
+
+    struct fault final {
+        jpeg_error_mgr base {};
+        std::jmp_buf   jump {};
+    };
+
+    static jpeg_decompress_struct jpeg {};
+    static fault                  jerr {};
+
+    //// AUTOMATIC LOOP OF THE CAMERA - SWITCH, VALUE IT DRIVES, SWITCH SETTING FOR MANUAL
+    struct knob final {
+        zx::u32 automatic {};
+        zx::u32 value     {};
+        zx::i32 manual    {};
+        zx::i32 saved     {}; // switch before the lock
+        bool    held      {};
+    };
+
+    static knob knobs[3] {
+        { V4L2_CID_EXPOSURE_AUTO,      V4L2_CID_EXPOSURE_ABSOLUTE,          V4L2_EXPOSURE_MANUAL },
+        { V4L2_CID_AUTOGAIN,           V4L2_CID_GAIN,                       0 },
+        { V4L2_CID_AUTO_WHITE_BALANCE, V4L2_CID_WHITE_BALANCE_TEMPERATURE,  0 },
+    };
 }
 
 ///////////////////////////////////////
@@ -31,6 +61,30 @@ static int xioctl(int fh, unsigned long int request, void *arg) noexcept {
     return r;
 }
 
+///////////////////////////////////////
+//// CONTROLS - QUERY / GET / SET   ////
+///////////////////////////////////////
+static bool known (const zx::u32 id) noexcept {
+    struct v4l2_queryctrl query {};
+    query.id = id;
+    return 0 == xioctl(core::fd, VIDIOC_QUERYCTRL, &query) and not (query.flags & V4L2_CTRL_FLAG_DISABLED);
+}
+
+static bool get (const zx::u32 id, zx::i32& value) noexcept {
+    struct v4l2_control ctrl {};
+    ctrl.id = id;
+    if (-1 == xioctl(core::fd, VIDIOC_G_CTRL, &ctrl)) return false;
+    value = ctrl.value;
+    return true;
+}
+
+static bool set (const zx::u32 id, const zx::i32 value) noexcept {
+    struct v4l2_control ctrl {};
+    ctrl.id    = id;
+    ctrl.value = value;
+    return 0 == xioctl(core::fd, VIDIOC_S_CTRL, &ctrl);
+}
+
 ///////////////////////////////////////
 //// LOW LEVEL DEVICE MEMORY MAP   ////
 ///////////////////////////////////////
@@ -153,30 +207,189 @@ static void convert(const zx::u08 *src, zx::u08 *dst, zx::u32 w, zx::u32 h, zx::
 ///////////////////////////////////////
 //// CONVERT YUYV:4:2:2 TO GRAY    ////
 ///////////////////////////////////////
+//// graph is 1/scale of the frame: only every scale-th line is touched,
+//// so HD/4K frames never materialize at full resolution
+ZX_CLONES
 static void convert(const zx::u08* src, const zx::graph& graph) noexcept {
 
-    zx::i32 j = 0;
-
-    zx::i32 height = zx::i32(graph.height);
-    zx::i32 width  = zx::i32(graph.width);
-    zx::i32 stride = zx::i32(core::bpline);
+    const zx::u32 step = core::scale;
 
-    zx::u08 *dst = graph.data;
-
-    while (--height >= 0)
+    for (zx::u32 y = 0; y < graph.height; ++y)
     {
-        for (j = 0; j + 1 < width; j += 2)
+        const zx::u08 *line = src + zx::u64(y) * step * core::bpline;
+        zx::u08       *dst  = graph.data + zx::u64(y) * graph.width;
+
+        for (zx::u32 x = 0; x < graph.width; ++x)
         {
-            *dst++ = zx::u08(src[0]); //// YUYV4:2>2 [Y][U][Y][V]
-            *dst++ = zx::u08(src[2]); //// GRAYSCALE [Y] x [Y] x
-             src  += 4;
+            dst[x] = line[2 * x * step]; //// YUYV4:2:2 [Y][U][Y][V] -> [Y]
+        }
+    }
+}
+
+///////////////////////////////////////
+//// MODE NEGOTIATION              ////
+///////////////////////////////////////
+static zx::u32 fourcc (const zx::wc::pixel pixel) noexcept {
+    return (pixel == zx::wc::pixel::MJPG) ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+}
+
+//// highest frame rate offered for one format and size
+static zx::u32 best_rate (const zx::u32 format, const zx::su32 size) noexcept {
+
+    struct v4l2_frmivalenum ival {};
+    zx::u32 rate = 0;
+
+    std::memset(&ival, 0, sizeof(ival));
+
+    ival.pixel_format = format;
+    ival.width        = size.w;
+    ival.height       = size.h;
+
+    for (ival.index = 0; 0 == xioctl(core::fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival); ++ival.index) {
+
+        const struct v4l2_fract f = (ival.type == V4L2_FRMIVAL_TYPE_DISCRETE) ? ival.discrete : ival.stepwise.min;
+
+        if (f.numerator) {
+            const zx::u32 fps = f.denominator / f.numerator;
+            rate = fps > rate ? fps : rate;
+        }
+
+        if (ival.type != V4L2_FRMIVAL_TYPE_DISCRETE) break;
+    }
+
+    return rate;
+}
+
+//// order: meets rate, largest size not above request, preferred format, faster
+static bool better (const zx::wc::mode& a, const zx::wc::mode& b, const zx::wc::mode& want) noexcept {
+
+    const bool ra = a.rate >= want.rate, rb = b.rate >= want.rate;
+    if (ra != rb) return ra;
+
+    const bool fa = a.size.w <= want.size.w and a.size.h <= want.size.h;
+    const bool fb = b.size.w <= want.size.w and b.size.h <= want.size.h;
+    if (fa != fb) return fa;
+
+    const zx::u64 aa = zx::u64(a.size.w) * a.size.h;
+    const zx::u64 ab = zx::u64(b.size.w) * b.size.h;
+    if (aa != ab) return fa ? aa > ab : aa < ab;
+
+    const bool pa = a.form == want.form, pb = b.form == want.form;
+    if (pa != pb) return pa;
+
+    return a.rate > b.rate;
+}
+
+static zx::wc::mode negotiate (const zx::wc::mode& want) noexcept {
+
+    struct v4l2_fmtdesc desc {};
+    zx::wc::mode best {};
+    bool         some = false;
+
+    std::memset(&desc, 0, sizeof(desc));
+
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    for (desc.index = 0; 0 == xioctl(core::fd, VIDIOC_ENUM_FMT, &desc); ++desc.index) {
+
+        zx::wc::pixel form {};
+
+        switch (desc.pixelformat) {
+            case V4L2_PIX_FMT_MJPEG: form = zx::wc::pixel::MJPG; break;
+            case V4L2_PIX_FMT_YUYV:  form = zx::wc::pixel::YUYV; break;
+            default: continue;
+        }
+
+        struct v4l2_frmsizeenum size {};
+
+        std::memset(&size, 0, sizeof(size));
+
+        size.pixel_format = desc.pixelformat;
+
+        for (size.index = 0; 0 == xioctl(core::fd, VIDIOC_ENUM_FRAMESIZES, &size); ++size.index) {
+
+            zx::su32 wh {};
+
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                wh = { size.discrete.width, size.discrete.height };
+            } else {
+                //// STEPWISE/CONTINUOUS - REQUEST CLAMPED TO THE STEP GRID
+                const struct v4l2_frmsize_stepwise& sw = size.stepwise;
+                const zx::u32 w = want.size.w < sw.min_width  ? sw.min_width  : (want.size.w > sw.max_width  ? sw.max_width  : want.size.w);
+                const zx::u32 h = want.size.h < sw.min_height ? sw.min_height : (want.size.h > sw.max_height ? sw.max_height : want.size.h);
+                wh = { w - (w - sw.min_width)  % (sw.step_width  ? sw.step_width  : 1),
+                       h - (h - sw.min_height) % (sw.step_height ? sw.step_height : 1) };
+            }
+
+            const zx::wc::mode next { wh, best_rate(desc.pixelformat, wh), form };
+
+            if (not some or better(next, best, want)) {
+                best = next;
+                some = true;
+            }
+
+            if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) break;
         }
-        src += stride - (width * 2);
     }
+
+    if (not some) {
+        std::fprintf(stderr, "info: enumeracao de modos nao suportada, usando %ux%u\n", want.size.w, want.size.h);
+        return want;
+    }
+
+    return best;
+}
+
+///////////////////////////////////////
+//// DECODE MJPG TO GRAY (Y ONLY)  ////
+///////////////////////////////////////
+static void jpeg_fault (j_common_ptr info) noexcept {
+    std::longjmp(reinterpret_cast<core::fault*>(info->err)->jump, 1);
+}
+
+static bool decode(const zx::u08* src, const std::size_t size, const zx::graph& graph) noexcept {
+
+    jpeg_decompress_struct& jpeg = core::jpeg;
+
+    if (setjmp(core::jerr.jump)) {
+        jpeg_abort_decompress(&jpeg);
+        return false;                                // corrupt frame, buffer half written
+    }
+
+    jpeg_mem_src(&jpeg, src, static_cast<unsigned long>(size));
+
+    if (JPEG_HEADER_OK != jpeg_read_header(&jpeg, TRUE)) {
+        jpeg_abort_decompress(&jpeg);
+        return false;
+    }
+
+    //// GRAYSCALE OUTPUT SKIPS CHROMA IDCT, UPSAMPLING AND COLOR CONVERSION
+    jpeg.out_color_space     = JCS_GRAYSCALE;
+    jpeg.scale_num           = 1;
+    jpeg.scale_denom         = core::scale;
+    jpeg.dct_method          = JDCT_IFAST;
+    jpeg.do_fancy_upsampling = FALSE;
+    jpeg.do_block_smoothing  = FALSE;
+
+    jpeg_start_decompress(&jpeg);
+
+    if (jpeg.output_width != graph.width or jpeg.output_height != graph.height) {
+        jpeg_abort_decompress(&jpeg);
+        return false;
+    }
+
+    while (jpeg.output_scanline < jpeg.output_height) {
+        JSAMPROW line = graph.data + jpeg.output_scanline * graph.width;
+        jpeg_read_scanlines(&jpeg, &line, 1);
+    }
+
+    jpeg_finish_decompress(&jpeg);
+
+    return true;
 }
 
 bool
-zx::wc::cam_init_impl (const char* device) noexcept {
+zx::wc::cam_init_impl (const char* device, const mode& want) noexcept {
 
     struct stat            st   {}; // DEVICE STATUS
     struct v4l2_capability cap  {}; // DEVICE CAPABILITIES
@@ -232,38 +445,73 @@ zx::wc::cam_init_impl (const char* device) noexcept {
         }
     }
 
+    //// ENUM_FMT / ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS
+    const zx::wc::mode mode = negotiate(want);
+
     //// FORMATO DE VIDEO/IMAGEM - REQUEST PACKET
     fmt.type                = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width       = 640; // VALOR MAXIMOS DO DISPOSITIVO TESTADO (WIDTH)
-    fmt.fmt.pix.height      = 480; // VALOR MAXIMOS DO DISPOSITIVO TESTADO (HEIGHT)
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+    fmt.fmt.pix.width       = mode.size.w;
+    fmt.fmt.pix.height      = mode.size.h;
+    fmt.fmt.pix.pixelformat = fourcc(mode.form);
     fmt.fmt.pix.field       = V4L2_FIELD_INTERLACED;
 
     if (-1 == xioctl(core::fd, VIDIOC_S_FMT, &fmt))
-        std::fprintf(stderr, "erro: formato de video nao suportado (640x480 :INTERLACED: YUYV 4:2:2)\n");
+        std::fprintf(stderr, "erro: formato de video nao suportado (%ux%u :INTERLACED: YUYV 4:2:2 | MJPG)\n", mode.size.w, mode.size.h);
+
+    //// DRIVER MAY ANSWER WITH THE OTHER FORMAT
+    switch (fmt.fmt.pix.pixelformat) {
+        case V4L2_PIX_FMT_MJPEG: core::pixel = zx::wc::pixel::MJPG; break;
+        case V4L2_PIX_FMT_YUYV:  core::pixel = zx::wc::pixel::YUYV; break;
+        default:
+            std::fprintf(stderr, "erro: formato de imagem nao suportado (%ux%u :INTERLACED: YUYV 4:2:2 | MJPG)\n", mode.size.w, mode.size.h);
+    }
+
+    //// FRAME RATE - REQUEST PACKET
+    struct v4l2_streamparm parm {};
+
+    std::memset(&parm, 0, sizeof(parm));
+
+    parm.type                                  = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator   = 1;
+    parm.parm.capture.timeperframe.denominator = mode.rate ? mode.rate : want.rate;
+
+    if (-1 == xioctl(core::fd, VIDIOC_S_PARM, &parm))
+        std::fprintf(stderr, "info: taxa de quadros nao ajustavel\n");
 
-    if (fmt.fmt.pix.pixelformat != V4L2_PIX_FMT_YUYV)
-        std::fprintf(stderr, "erro: formato de imagem nao suportado (640x480 :INTERLACED: YUYV 4:2:2)\n");
+    core::mode.size = { fmt.fmt.pix.width, fmt.fmt.pix.height };
+    core::mode.form = core::pixel;
+    core::mode.rate = parm.parm.capture.timeperframe.numerator
+                    ? parm.parm.capture.timeperframe.denominator / parm.parm.capture.timeperframe.numerator
+                    : mode.rate;
 
     ////       0  X  1  Y
     //// YUYV [Y][U][Y][V] 2bpp
     core::bpline = fmt.fmt.pix.bytesperline;
 
-    //// FORMATO DE VIDEO/IMAGEM - RESPONSE
-    //// RGB FRAME
-    core::frame.width  = fmt.fmt.pix.width;
-    core::frame.height = fmt.fmt.pix.height;
-    core::frame.stride = core::frame.width * 4;
-    core::frame.size   = core::frame.width * core::frame.height * 4; /// rgba:4
-    core::frame.data   = new zx::u08[core::frame.size];
-    //// GRAY GRAPH
-    core::graph.width  = fmt.fmt.pix.width;
-    core::graph.height = fmt.fmt.pix.height;
-    core::graph.size   = core::graph.width * core::graph.height;
-    core::graph.data   = new zx::u08[core::graph.size];
+    //// FORMATO DE VIDEO/IMAGEM - RESPONSE - ONLY GRAY IS EVER CONVERTED, NO RGBA COPY
+    core::frame = { fmt.fmt.pix.width, fmt.fmt.pix.height };
 
     init_mmap();
 
+    return true;
+}
+
+bool
+zx::wc::cam_link_impl (const u32 scale) noexcept {
+
+    //// DCT SCALING ONLY IN 1/1, 1/2, 1/4 AND 1/8 - YUYV DECIMATES THE SAME WAY
+    core::scale = (scale >= 8) ? 8 : (scale >= 4) ? 4 : (scale >= 2) ? 2 : 1;
+
+    if (core::pixel == zx::wc::pixel::MJPG) {
+        core::jpeg.err             = jpeg_std_error(&core::jerr.base);
+        core::jerr.base.error_exit = jpeg_fault;
+        jpeg_create_decompress(&core::jpeg);
+    }
+
+    //// GRAY SIZE - ALREADY AT 1/scale, BUFFERS BELONG TO cam_grab_impl CALLERS
+    core::gray = { (core::frame.w + core::scale - 1) / core::scale,
+                   (core::frame.h + core::scale - 1) / core::scale };
+
     link_buffers();
 
     return true;
@@ -280,6 +528,8 @@ zx::wc::cam_stop_impl (void) noexcept {
     if (-1 == xioctl(core::fd, VIDIOC_STREAMOFF, &type))
         std::fprintf(stderr, "erro: falha ao parar captura\n");
 
+    cam_lock_impl(false);                      // uvc cameras keep manual controls across opens
+
     for (i = 0; i < core::nbuffer; ++i)
         if (-1 == munmap(core::buffers[i].data, core::buffers[i].size))
             std::fprintf(stderr, "erro: falha ao desmapear memoria da camera\n");
@@ -296,17 +546,17 @@ zx::wc::cam_stop_impl (void) noexcept {
 
     core::fd = -1;
 
-    delete [] core::frame.data;
-    delete [] core::graph.data;
+    if (core::pixel == zx::wc::pixel::MJPG)
+        jpeg_destroy_decompress(&core::jpeg);
 
-    core::frame.data = nullptr;
-    core::graph.data = nullptr;
+    core::gray  = {};
+    core::frame = {};
 
     return true;
 }
 
 bool
-zx::wc::cam_read_impl (void) noexcept {
+zx::wc::cam_grab_impl (const graph& dst) noexcept {
 
     struct v4l2_buffer buf {};
 
@@ -315,19 +565,54 @@ zx::wc::cam_read_impl (void) noexcept {
     buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     buf.memory = V4L2_MEMORY_MMAP;
 
-    if (-1 == xioctl(core::fd, VIDIOC_DQBUF, &buf)) {
+    int got = 0;
+
+    {
+        ZX_SPAN("dqbuf");                       // stalls show up here
+        got = xioctl(core::fd, VIDIOC_DQBUF, &buf);
+    }
+
+    if (-1 == got) {
         switch (errno) {
             case EAGAIN:
                 return true;
             case EIO:
                 default:
                     std::fprintf(stderr, "erro: falha ao copiar o buffer\n");
+                    return true;            // nothing dequeued
         }
     }
 
     assert(buf.index < core::nbuffer);
 
-    convert((zx::u08 *) core::buffers[buf.index].data, core::graph);
+    bool fault = false;
+
+    if (core::pixel == zx::wc::pixel::MJPG) {
+        ZX_SPAN("decode");
+        fault = not decode((zx::u08 *) core::buffers[buf.index].data, buf.bytesused, dst);
+        if (fault) std::fprintf(stderr, "erro: quadro mjpg corrompido\n");
+    } else {
+        ZX_SPAN("convert");
+        convert((zx::u08 *) core::buffers[buf.index].data, dst);
+    }
+
+    if (-1 == xioctl(core::fd, VIDIOC_QBUF, &buf))
+        std::fprintf(stderr, "erro: falha ao copiar o buffer\n");
+
+    return fault;                               // corrupt: dst is stale or half written, not published
+}
+
+bool
+zx::wc::cam_drop_impl (void) noexcept {
+
+    struct v4l2_buffer buf {};
+
+    std::memset(&buf, 0, sizeof(buf));
+
+    buf.type   = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+
+    if (-1 == xioctl(core::fd, VIDIOC_DQBUF, &buf)) return true;
 
     if (-1 == xioctl(core::fd, VIDIOC_QBUF, &buf))
         std::fprintf(stderr, "erro: falha ao copiar o buffer\n");
@@ -335,18 +620,51 @@ zx::wc::cam_read_impl (void) noexcept {
     return false;
 }
 
-const zx::frame&
-zx::wc::cam_data_impl (void) noexcept {
-    return core::frame;
+bool
+zx::wc::cam_lock_impl (const bool lock) noexcept {
+
+    u32 held = 0;
+
+    for (core::knob& k : core::knobs) {
+
+        if (not lock) {
+            if (k.held and not set(k.automatic, k.saved))
+                std::fprintf(stderr, "erro: controle %08x nao voltou ao automatico\n", k.automatic);
+            k.held = false;
+            continue;
+        }
+
+        if (k.held) { ++held; continue; }
+
+        if (-1 == core::fd or not known(k.automatic)) continue;
+
+        //// VALUE THE AUTOMATIC LOOP SETTLED ON - SOME DRIVERS RESET IT WHEN SWITCHED TO MANUAL
+        i32        now  = 0;
+        const bool read = known(k.value) and get(k.value, now);
+
+        if (not get(k.automatic, k.saved) or not set(k.automatic, k.manual)) continue;
+
+        if (read) set(k.value, now);
+
+        k.held = true;
+        ++held;
+    }
+
+    return lock ? held > 0 : true;
 }
 
-const zx::graph&
+const zx::su32
 zx::wc::cam_gray_impl (void) noexcept {
-    return core::graph;
+    return core::gray;
 }
 
 const zx::su32
 zx::wc::cam_info_impl (void) noexcept {
-    return { core::frame.width, core::frame.height };
+    return core::frame;
+}
+
+const zx::wc::mode
+zx::wc::cam_mode_impl (void) noexcept {
+    return core::mode;
 }
 
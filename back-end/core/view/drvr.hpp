@@ -11,13 +11,27 @@ namespace zx::wc
         std::size_t  size {0};
     };
 
-    bool cam_init_impl (const char*) noexcept ;  // low level kernel memory and drive acces
+    enum struct pixel : u08 {
+        YUYV = 0,   // 4:2:2 raw, gray from the Y samples
+        MJPG = 1    // motion jpeg, luminance-only scaled decode
+    };
+
+    struct mode final {
+        su32  size {640, 480};     // largest accepted resolution
+        u32   rate {30};           // minimum frames per second
+        pixel form {pixel::MJPG};  // preferred format
+    };
+
+    bool cam_init_impl (const char*, const mode&) noexcept ; // negotiate format, size and rate
+    bool cam_link_impl (const u32) noexcept ;   // gray at 1/scale and start streaming
     bool cam_stop_impl (void) noexcept ;         // memory and kernel resources release
-    bool cam_read_impl (void) noexcept ;         // memory acces sync - read-only
+    bool cam_grab_impl (const graph&) noexcept ; // newest frame as gray in a cam_gray_impl sized buffer, true when busy or corrupt
+    bool cam_drop_impl (void) noexcept ;         // release newest frame without conversion
+    bool cam_lock_impl (const bool) noexcept ;   // exposure, gain, white balance held where auto left them (false: auto again), false when none holds
 
-    const frame& cam_data_impl (void) noexcept ; // ready rgba image
-    const graph& cam_gray_impl (void) noexcept ; // ready gray image
+    const su32   cam_gray_impl (void) noexcept ; // gray size after link
     const su32   cam_info_impl (void) noexcept ; // framebuffer info
+    const mode   cam_mode_impl (void) noexcept ; // negotiated mode
 }
 
 #endif
@@ -1,22 +1,50 @@
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include <cstring>
 
 #include "nccp.hpp"
+#include "heap.hpp"
+#include "task.hpp"
 
 namespace core {
+
+    //// SCALE SPACE - TEMPLATE SIZES FROM THE GLYPH DOWN TO HALF OF IT, SCANNED ON THE FRAME AND
+    //// ON ITS 2x2 MEAN: MARKERS FROM HALF TO TWICE THE GLYPH FOR A FEW TIMES ONE GLYPH SCAN
+    static constexpr zx::u32 most {5};  // template sizes, scales per octave + 1
+
+    struct scale final {
+        zx::graph glyphs[2] {};         // expanded kernels
+        zx::i64   tsum[2]   {};         // glyph sum of pixels
+        zx::i64   tvar[2]   {};         // glyph n * sum of squares - sum^2
+        zx::u32   step      {};         // glyph * 2^(-step / octave)
+    };
+
+    //// candidate of one scale, before the scales are merged
+    struct candidate final {
+        zx::match match {};
+        zx::u32   scale {};
+    };
+
     static zx::su32  ksize {5,5}; // kernel size
     static zx::su32  gsize {0,0}; // glyph  size
     static zx::su32  fsize {0,0}; // frame  size
-    static zx::graph              bypass    {};
-    static zx::graph              glyphs[2] {}; // expanded glyphs
+    static zx::u64               *bypass    {}; // suppression mask, one bit per frame pixel
+    static zx::u32                words     {}; // mask words per row
+    static bool                   rows      {}; // lean: one score row per glyph, computed on the way
+    static zx::u32                octave    {1}; // template sizes per octave, 1 = the glyph only
+    static zx::u32                sizes     {}; // templates in use
+    static scale                  scales[most] {};
+    static zx::graph              half      {}; // frame 2x2 mean, second pyramid level (octave > 1)
+    static zx::f32               *scores[2] {}; // correlation map per glyph (frame sized, or a row)
+    static std::vector<candidate> found     {}; // every scale, frame coordinates
     static std::vector<zx::match> matches   {}; // image detection matches
     static std::vector<zx::match> lots      {}; // parking lots
 }
 
 void
-zx::tm::init(const su32 gsize, const su32 fsize) noexcept {
+zx::tm::init(const su32 gsize, const su32 fsize, const bool rows, const u32 octave) noexcept {
 
     if (gsize.w > core::ksize.w and gsize.h > core::ksize.h and gsize.w == gsize.h) {
         core::gsize = gsize;
@@ -26,12 +54,31 @@ zx::tm::init(const su32 gsize, const su32 fsize) noexcept {
 
     core::matches.clear();
 
-    core::fsize = fsize;
+    core::fsize  = fsize;
+    core::rows   = rows;
+    core::octave = std::clamp(octave, 1u, core::most - 1);
+    core::words  = (fsize.w + 63) / 64;
+    core::bypass = reinterpret_cast<u64*>(mm::take(u64(core::words) * fsize.h * sizeof(u64)));
+
+    //// SIZES - glyph * 2^(-step / octave) DOWN TO HALF THE GLYPH, LARGER THAN THE KERNEL
+    core::sizes = 0;
+
+    for (u32 step = 0; step <= (core::octave > 1 ? core::octave : 0); ++step) {
+
+        const u32 side = u32(std::lround(f64(core::gsize.w) * std::exp2(-f64(step) / f64(core::octave))));
 
-    core::bypass.width  = core::fsize.w;
-    core::bypass.height = core::fsize.h;
-    core::bypass.size   = core::fsize.w * core::fsize.h;
-    core::bypass.data   = new u08[core::bypass.size];
+        if ((step and side <= core::ksize.w) or (core::sizes and side == core::scales[core::sizes - 1].glyphs[0].width)) continue;
+
+        core::scale& sc = core::scales[core::sizes++];
+        sc.step = step;
+        for (u32 g = 0; g < 2; ++g) sc.glyphs[g] = mm::image({ side, side });
+    }
+
+    if (core::octave > 1) core::half = mm::image({ fsize.w / 2, fsize.h / 2 });
+
+    for (u32 g = 0; g < 2; ++g) {
+        core::scores[g] = reinterpret_cast<f32*>(mm::take(u64(core::fsize.w) * (rows ? 1 : core::fsize.h) * sizeof(f32)));
+    }
 
     load();
 }
@@ -39,142 +86,326 @@ zx::tm::init(const su32 gsize, const su32 fsize) noexcept {
 void
 zx::tm::load(void) noexcept {
 
-    const u32 wd = core::gsize.w, WD = core::ksize.w;
-    const u32 ht = core::gsize.h, HT = core::ksize.h;
+    const u32 WD = core::ksize.w;
+    const u32 HT = core::ksize.h;
 
+    for (u32 s = 0; s < core::sizes; ++s)
     for (u32 g = 0; g < 2; ++g)
     {
-        core::glyphs[g].mean   = 0.0f;
-        core::glyphs[g].stdv   = 0.0f;
-        core::glyphs[g].vari   = 0.0f;
+        graph& glyph = core::scales[s].glyphs[g];
+
+        glyph.mean   = 0.0f;
+        glyph.stdv   = 0.0f;
+        glyph.vari   = 0.0f;
 
-        core::glyphs[g].width  = core::gsize.w;
-        core::glyphs[g].height = core::gsize.h;
-        core::glyphs[g].size   = core::gsize.w * core::gsize.h;
-        core::glyphs[g].data   = new u08[core::glyphs[g].size];
+        if (nullptr == glyph.data) continue;
+
+        const u32 wd = glyph.width, ht = glyph.height;
 
         for (u32 j = 0; j < ht; ++j) {
             u32 dj = j * HT / ht;
             for (u32 i = 0; i < wd; i++) {
                 u32 di = i * WD / wd;
-                core::glyphs[g].data[j * core::gsize.w + i] = tm::kernel[g][dj * core::ksize.w + di];
+                glyph.data[j * wd + i] = tm::kernel[g][dj * core::ksize.w + di];
             }
         }
 
-        const u32 size = core::glyphs[g].size;
-
-        f32 sum = 0.0f;
-        for (u32 i = 0; i < size; ++i)
-            sum += f32(core::glyphs[g].data[i]);
+        const u32 size = glyph.size;
 
-        core::glyphs[g].mean = sum / f32(core::glyphs[g].size);
-
-        f32 var = 0.0f;
+        i64 sum = 0, sqr = 0;
         for (u32 i = 0; i < size; ++i) {
-            const f32 v = f32(core::glyphs[g].data[i]) - core::glyphs[g].mean;
-            var += v * v;
+            sum += glyph.data[i];
+            sqr += glyph.data[i] * glyph.data[i];
         }
 
-        core::glyphs[g].stdv = (var <= 0.0f) ? 0.0f : std::sqrt(var);
+        core::scales[s].tsum[g] = sum;
+        core::scales[s].tvar[g] = i64(size) * sqr - sum * sum;
+
+        glyph.mean = f32(f64(sum) / f64(size));
+        glyph.vari = f32(f64(core::scales[s].tvar[g]) / f64(size));
+        glyph.stdv = std::sqrt(glyph.vari);
     }
 }
 
 
-[[maybe_unused]]
+//// src is a template sized window of the frame - integer moments, one rounding
+//// at the end. u32 sums hold windows up to 66051 pixels (255 * 255 each)
 static zx::f32
-compute(const zx::graph& src, const zx::graph& tpl, zx::u32 sx, zx::u32 sy) {
+compute(const zx::view& src, const zx::graph& tpl, const zx::i64 tsum, const zx::i64 tvar) {
 
-    using zx::u32, zx::f32, zx::u08;
+    using zx::u32, zx::i64, zx::f64, zx::u08;
 
     const u32 tw = tpl.width;
     const u32 th = tpl.height;
-    const u32 sz = tw * th;
 
-    f32 sum_src = 0.0f;
+    u32 sx = 0, sxx = 0, sxy = 0;
+
     for (u32 y = 0; y < th; ++y) {
+        const u08 *s = src.row(y);
+        const u08 *t = tpl.data + y * tpl.width;
         for (u32 x = 0; x < tw; ++x) {
-            sum_src += f32(src.data[(sy+y) * src.width + (sx+x)]);
+            sx  += s[x];
+            sxx += u32(s[x]) * s[x];
+            sxy += u32(s[x]) * t[x];
         }
     }
 
-    const f32 src_mean = sum_src / f32(sz);
-    const f32 tpl_mean = tpl.mean;
+    const i64 n   = i64(tw) * th;
+    const i64 num = n * sxy - i64(sx) * tsum;
+    const i64 var = n * sxx - i64(sx) * sx;
 
-    f32 numer = 0.0f;
-    f32 denom_src_sq = 0.0f;
-    for (u32 y = 0; y < th; ++y) {
-        for (u32 x = 0; x < tw; ++x) {
-            const f32 s = f32(src.data[(sy+y) * src.width + (sx+x)]) - src_mean;
-            const f32 t = f32(tpl.data[  y    * tpl.width +    x  ]) - tpl_mean;
-            numer += s * t;
-            denom_src_sq += s * s;
-        }
-    }
+    if (var <= 0 or tvar <= 0) return 0.0f;
+
+    return zx::f32(f64(num) / std::sqrt(f64(var) * f64(tvar)));
+}
+
+//// SUPPRESSION MASK - BIT x OF ROW y
+static bool
+taken (const zx::u32 x, const zx::u32 y) noexcept {
+    return (core::bypass[zx::u64(y) * core::words + (x >> 6)] >> (x & 63)) & 1;
+}
 
-    f32 denom = denom_src_sq * (tpl.stdv * tpl.stdv);
-    if (denom <= 0.0) {
-        return 0.0;
+static void
+claim (const zx::ru32& area) noexcept {
+    for (zx::u32 y = area.y; y < area.y + area.h; ++y) {
+        zx::u64 *row = core::bypass + zx::u64(y) * core::words;
+        for (zx::u32 x = area.x; x < area.x + area.w; ++x) row[x >> 6] |= zx::u64(1) << (x & 63);
     }
+}
 
-    return numer / std::sqrt(denom);
+//// one output row of the correlation map, compute inlined per clone
+ZX_CLONES
+static void
+correlate(const zx::view& frame, const core::scale& sc, const zx::u32 g, const zx::u32 y, const zx::u32 x0, const zx::u32 x1, zx::f32 *line) noexcept {
+    const zx::graph& tpl = sc.glyphs[g];
+    for (zx::u32 x = x0; x < x1; ++x) {
+        line[x] = compute(frame.crop({x, y, tpl.width, tpl.height}), tpl, sc.tsum[g], sc.tvar[g]);
+    }
 }
 
-void
-zx::tm::stop(void) noexcept {
-    for (u32 g = 0; g < 2; ++g) {
-        delete [] core::glyphs[g].data;
-        core::glyphs[g].data = nullptr;
+//// second pyramid level over the region, rounded 2x2 mean
+static zx::ru32
+shrink(const zx::view& frame, const zx::ru32& area) noexcept {
+
+    const zx::view half = core::half;
+    const zx::ru32 part { area.x / 2, area.y / 2,
+                          std::min(half.width,  (area.x + area.w) / 2) - area.x / 2,
+                          std::min(half.height, (area.y + area.h) / 2) - area.y / 2 };
+
+    for (zx::u32 y = part.y; y < part.y + part.h; ++y) {
+        const zx::u08 *a = frame.row(2 * y);
+        const zx::u08 *b = frame.row(2 * y + 1);
+        zx::u08       *d = half.row(y);
+        for (zx::u32 x = part.x; x < part.x + part.w; ++x)
+            d[x] = zx::u08((a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2);
     }
+
+    return part;
 }
 
-void
-zx::tm::proc(const zx::graph& graph, const f32 min) noexcept
-{
-    const u32 out_w = graph.width  - core::gsize.w + 1;
-    const u32 out_h = graph.height - core::gsize.h + 1;
+//// GREEDY SUPPRESSION OF ONE SCALE - SAME ORDER AS A SERIAL SCAN, LEVEL 1 DOUBLED BACK
+static void
+greedy(const zx::view& frame, const zx::ru32& area, const zx::u32 s, const zx::u32 level, const zx::f32 min) noexcept {
 
-    core::matches.clear();
+    using zx::u32, zx::u64, zx::f32;
+
+    const core::scale& sc   = core::scales[s];
+    const zx::su32     size { sc.glyphs[0].width, sc.glyphs[0].height };
+
+    if (area.w < size.w or area.h < size.h) return;
 
-    std::memset(core::bypass.data, 0, core::bypass.size);
+    //// FEWER PIXELS, MORE CHANCE TEXTURE CORRELATES - THE MISS ALLOWED (1 - min) SHRINKS
+    //// WITH THE PIXEL COUNT OF THE TEMPLATE
+    const f32 part = f32(size.w * size.h) / f32(core::gsize.w * core::gsize.h);
+    const f32 sure = size.w < core::gsize.w ? 1.0f - (1.0f - min) * part : min;
+
+    //// GLYPH POSITIONS FULLY INSIDE THE REGION
+    const u32 x0 = area.x, x1 = area.x + area.w - size.w + 1;
+    const u32 y0 = area.y, y1 = area.y + area.h - size.h + 1;
+
+    std::memset(core::bypass, 0, u64(core::words) * core::fsize.h * sizeof(u64));
+
+    //// CORRELATION MAP - ROW BANDS STOLEN BY THE WORKERS (LEAN: ROW BY ROW BELOW)
+    if (not core::rows) {
+        zx::tk::loop(y1 - y0, 8, [&](const u32 begin, const u32 end) {
+            for (u32 g = 0; g < 2; ++g) {
+                for (u32 y = y0 + begin; y < y0 + end; ++y) {
+                    correlate(frame, sc, g, y, x0, x1, core::scores[g] + u64(y) * core::fsize.w);
+                }
+            }
+        });
+    }
 
     for (u32 g = 0; g < 2; ++g)
     {
-        for (u32 y = 0; y < out_h; ++y)
+        for (u32 y = y0; y < y1; ++y)
         {
-            for (u32 x = 0; x < out_w; ++x)
+            const f32 *line = core::scores[g];
+
+            if (core::rows) correlate(frame, sc, g, y, x0, x1, core::scores[g]);
+            else            line += u64(y) * core::fsize.w;
+
+            for (u32 x = x0; x < x1; ++x)
             {
-                if (core::bypass.data[y * core::fsize.w + x] == 1) continue;
+                if (taken(x, y)) continue;
 
-                f32 score = compute(graph, core::glyphs[g], x, y);
+                f32 score = line[x];
 
-                if (score >= min)
+                if (score >= sure)
                 {
-                    for (u32 j = (y-1); j < (y+core::gsize.h+1); ++j) {
-                        for (u32 i = (x-1); i < (x+core::gsize.w+1); ++i) {
-                            core::bypass.data[j * core::fsize.w + i] = 1;
-                        }
-                    }
-                    core::matches.emplace_back(zx::match{ g, score, 0, {x,y,core::gsize.w,core::gsize.h} });
+                    const u32 sx = x ? x - 1 : 0;
+                    const u32 sy = y ? y - 1 : 0;
+
+                    claim(frame.clip({sx, sy, x + size.w + 1 - sx, y + size.h + 1 - sy}));
+
+                    core::found.push_back({ zx::match{ g, score, 0, {x << level, y << level, size.w << level, size.h << level} },
+                                            level * core::most + s });
                 }
             }
         }
     }
+}
+
+//// CROSS SCALE SUPPRESSION - BEST FIRST, A MARKER OF ANOTHER SCALE MOSTLY UNDER IT IS THE
+//// SAME MARKER. WITHIN A SCALE THE GREEDY SCAN ALREADY DECIDED
+static void
+merge(void) noexcept {
+
+    std::stable_sort(core::found.begin(), core::found.end(), [](const core::candidate& a, const core::candidate& b) {
+        return a.match.score > b.match.score;
+    });
+
+    std::vector<const core::candidate*> kept {};
+
+    for (const core::candidate& c : core::found) {
+
+        bool alone = true;
+
+        for (const core::candidate* k : kept) {
+
+            if (k->scale == c.scale) continue;
+
+            const zx::ru32& a = k->match.area;
+            const zx::ru32& b = c.match.area;
+
+            const zx::u32 x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+            const zx::u32 x1 = std::min(a.x + a.w, b.x + b.w), y1 = std::min(a.y + a.h, b.y + b.h);
+
+            if (x1 <= x0 or y1 <= y0) continue;
+
+            alone = 2 * zx::u64(x1 - x0) * (y1 - y0) <= zx::u64(std::min(a.w * a.h, b.w * b.h));
+
+            if (not alone) break;
+        }
+
+        if (alone) kept.push_back(&c);
+    }
+
+    //// SERIAL SCAN ORDER - LOT ORDER AND IDS AS WITH ONE SCALE
+    std::sort(kept.begin(), kept.end(), [](const core::candidate* a, const core::candidate* b) {
+        const zx::match& p = a->match;
+        const zx::match& q = b->match;
+        return p.mask != q.mask ? p.mask < q.mask : p.area.y != q.area.y ? p.area.y < q.area.y : p.area.x < q.area.x;
+    });
+
+    for (const core::candidate* k : kept) core::matches.push_back(k->match);
+}
+
+void
+zx::tm::stop(void) noexcept {
+    for (u32 s = 0; s < core::most; ++s)
+        for (u32 g = 0; g < 2; ++g) core::scales[s].glyphs[g].data = nullptr; // arena owned
+
+    for (u32 g = 0; g < 2; ++g) core::scores[g] = nullptr;
+
+    core::half.data = nullptr;
+    core::bypass    = nullptr;
+    core::sizes     = 0;
+}
+
+void
+zx::tm::proc(const zx::graph& graph, const f32 min) noexcept {
+    scan(graph, min, { 0, 0, graph.width, graph.height });
+}
+
+void
+zx::tm::scan(const zx::graph& graph, const f32 min, const ru32 region) noexcept
+{
+    const view frame = graph;
+    const ru32 area  = frame.clip(region);
+
+    core::matches.clear();
+    core::lots.clear();
+    core::found.clear();
+
+    //// EVERY TEMPLATE ON THE FRAME, ALL BUT THE HALF GLYPH AGAIN ON THE 2x2 MEAN
+    for (u32 s = 0; s < core::sizes; ++s) greedy(frame, area, s, 0, min);
+
+    if (core::octave > 1) {
+        const ru32 part = shrink(frame, area);
+        for (u32 s = 0; s < core::sizes; ++s)
+            if (core::scales[s].step < core::octave) greedy(core::half, part, s, 1, min);
+    }
+
+    if (core::octave > 1) {
+        merge();
+    } else {
+        for (const core::candidate& c : core::found) core::matches.push_back(c.match);
+    }
 
     site();
 }
 
+zx::f32
+zx::tm::score(const zx::graph& graph, const u32 g, const pu32 at) noexcept {
+
+    const view frame = graph;
+    f32        best  = 0.0f;
+
+    if (g > 1) return best;
+
+    //// FRAME LEVEL SIZES, A BOTTOM-RIGHT MARKER KEEPS ITS BOTTOM-RIGHT AT THE GLYPH'S
+    for (u32 s = 0; s < core::sizes; ++s) {
+
+        const core::scale& sc   = core::scales[s];
+        const u32    side = sc.glyphs[g].width;
+        const u32    ox   = g ? at.x + core::gsize.w - side : at.x;
+        const u32    oy   = g ? at.y + core::gsize.h - side : at.y;
+
+        if (graph.width < side or graph.height < side) continue;
+
+        //// +-1 PIXEL - THE LOT AREA ONLY KEEPS THE CORNER APPROXIMATELY AT THE FRAME EDGE
+        for (u32 y = oy ? oy - 1 : 0; y <= oy + 1 and y + side <= graph.height; ++y) {
+            for (u32 x = ox ? ox - 1 : 0; x <= ox + 1 and x + side <= graph.width; ++x) {
+                const f32 v = compute(frame.crop({x, y, side, side}), sc.glyphs[g], sc.tsum[g], sc.tvar[g]);
+                if (v > best) best = v;
+            }
+        }
+    }
+
+    return best;
+}
+
 void
 zx::tm::site(void) noexcept {
+    core::lots = pair(core::matches);
+}
+
+std::vector<zx::match>
+zx::tm::pair(const std::vector<zx::match>& sets) noexcept {
 
     std::vector<zx::pu32> tlv {};
     std::vector<zx::pu32> brv {};
+    std::vector<zx::match> lots {};
 
-    core::lots.clear();
-
-    for (const zx::match& m : core::matches) {
+    //// A BOTTOM-RIGHT MARKER OF ANY SIZE STANDS AS THE GLYPH SHARING ITS BOTTOM-RIGHT CORNER,
+    //// SO LOT + GLYPH STILL ENDS WITH THE MARKER
+    for (const zx::match& m : sets) {
+        const u32 bx = m.area.x + m.area.w > core::gsize.w ? m.area.x + m.area.w - core::gsize.w : 0;
+        const u32 by = m.area.y + m.area.h > core::gsize.h ? m.area.y + m.area.h - core::gsize.h : 0;
         switch (m.mask) {
             case 0: tlv.emplace_back(pu32{m.area.x,m.area.y}); break;
-            case 1: brv.emplace_back(pu32{m.area.x,m.area.y}); break;
+            case 1: brv.emplace_back(pu32{bx,by}); break;
         }
     }
 
@@ -190,14 +421,21 @@ zx::tm::site(void) noexcept {
             }
         }
 
-        core::lots.emplace_back(zx::match{0,0,0,{tl.x - 1, tl.y - 1, tlbrp.x + 1, tlbrp.y + 1}});
+        if (0xFFFFFFFF == tlbrd) continue; // no bottom-right corner
+
+        const u32 sx = tl.x ? tl.x - 1 : 0;
+        const u32 sy = tl.y ? tl.y - 1 : 0;
+
+        lots.emplace_back(zx::match{0,0,0,{sx, sy, tlbrp.x + 1 - sx, tlbrp.y + 1 - sy}});
     }
+
+    return lots;
 }
 
 
 const zx::graph&
 zx::tm::glyph(const u32 index) noexcept {
-    return core::glyphs[index];
+    return core::scales[0].glyphs[index];
 }
 
 
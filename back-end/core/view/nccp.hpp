@@ -20,13 +20,18 @@ namespace zx::tm
       0x00, 0x00, 0x00, 0x00, 0x00 },
     };
 
-    void init (const su32,  const su32) noexcept ;
+    void init (const su32,  const su32, const bool, const u32) noexcept ; // glyph, frame, lean (score rows instead of maps), sizes per octave
     void proc (const graph&, const f32) noexcept ;
+    void scan (const graph&, const f32, const ru32) noexcept ; // proc restricted to a region, markers of every scale
     void stop (void) noexcept ;
     void load (void) noexcept ;
     void site (void) noexcept ;
 
-    const zx::graph&              glyph   (const u32) noexcept ;
+    f32  score (const graph&, const u32, const pu32) noexcept ; // best glyph correlation within +-1 pixel, glyph and smaller
+
+    std::vector<zx::match>        pair    (const std::vector<zx::match>&) noexcept ; // corner markers -> lots
+
+    const zx::graph&              glyph   (const u32) noexcept ; // nominal size
     const std::vector<zx::match>& matches (void)      noexcept ;
     const std::vector<zx::match>& lots    (void)      noexcept ;
 }
@@ -0,0 +1,236 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipe.hpp"
+#include "trip.hpp"
+#include "clck.hpp"
+#include "trce.hpp"
+#include "view.hpp"
+#include "shmp.hpp"
+#include "prvw.hpp"
+#include "srvr.hpp"
+
+namespace core {
+
+    //// ANALYSIS -> PUBLISH - copied out, the detector reuses its buffers on the next frame
+    struct result final {
+        zx::graph              image   {};  // low res frame, before overlay
+        zx::graph              overlay {};  // low res frame, with lot overlay
+        std::vector<zx::match> lots    {};
+        std::string            svg     {};  // drawing file
+    };
+
+    static zx::triple<zx::graph>    frames  {};     // capture  -> analysis
+    static zx::triple<result>       posts   {};     // analysis -> publish
+    static std::counting_semaphore<> shot   {0};    // frames published by capture
+    static std::counting_semaphore<> sent   {0};    // results published by analysis
+    static std::atomic<bool>        print   {};     // svg due, survives dropped results
+    static std::atomic<bool>        running {};
+    static std::thread              capture {};
+    static std::thread              publish {};
+    static std::vector<zx::u08>     store   {};     // every slot, outside the arena (tune drops it)
+    static bool                     lean    {};     // one thread, one capture buffer, no result copies
+
+    static constexpr std::chrono::milliseconds nap {20}; // longest stage wait, commands stay responsive
+}
+
+namespace local {
+
+//// CAPTURE - DECIMATION DECIDED HERE, SKIPPED FRAMES ARE NEVER CONVERTED
+static void
+capture (void) noexcept {
+
+    ZX_NAME("capture");
+
+    while (core::running.load(std::memory_order_relaxed)) {
+
+        if (zx::ck::due()) {
+            ZX_SPAN("capture");
+            if (zx::vw::grab(core::frames.back())) {
+                zx::ck::take();
+                core::frames.publish();
+                core::shot.release();
+            }
+        } else {
+            ZX_SPAN("skip");
+            zx::vw::skip();
+        }
+
+        zx::ck::wait();
+    }
+}
+
+//// SHARED MEMORY, PREVIEW, SERVER SNAPSHOT
+static void
+deliver (const zx::view& image, const zx::view& overlay, const std::vector<zx::match>& lots) noexcept {
+    ZX_SPAN("publish");
+    zx::sm::push(image, overlay, lots);
+    zx::pv::push(overlay);
+    zx::sv::push(lots, { image.width, image.height });
+}
+
+//// PUBLISH - RESULTS AND SVG
+static void
+publish (void) noexcept {
+
+    ZX_NAME("publish");
+
+    while (core::running.load(std::memory_order_relaxed)) {
+
+        if (not core::sent.try_acquire_for(core::nap)) continue;
+
+        while (core::sent.try_acquire()) {}
+
+        const bool print = core::print.exchange(false, std::memory_order_acquire); // set after its result
+        const bool fresh = core::posts.fetch();
+
+        if (not fresh and not print) continue;
+
+        const core::result& post = core::posts.front();
+
+        if (fresh) deliver(post.image, post.overlay, post.lots);
+
+        if (print) zx::vw::print(post.lots, { post.overlay.width, post.overlay.height }, post.svg);
+    }
+}
+
+//// low res frame into a result slot
+static void
+clone (const zx::graph& src, zx::graph& dst) noexcept {
+
+    assert(src.width * src.height <= dst.size);
+
+    dst.width  = src.width;
+    dst.height = src.height;
+
+    std::memcpy(dst.data, src.data, zx::u64(src.width) * src.height);
+}
+
+//// LEAN - THE THREE STAGES IN A ROW ON THE CALLER, AS BEFORE THE PIPELINE
+static bool
+alone (void) noexcept {
+
+    bool done = false;
+
+    if (zx::ck::due()) {
+
+        {
+            ZX_SPAN("capture");
+            done = zx::vw::grab(core::frames.slot[0]);
+        }
+
+        if (done) {
+            zx::ck::take();
+            {
+                ZX_SPAN("analysis");
+                zx::ck::open();
+                zx::vw::feed(core::frames.slot[0]);
+                zx::ck::shut(zx::vw::idle());
+            }
+            deliver(zx::vw::image(), zx::vw::overlay(), zx::vw::lots());
+            if (zx::vw::dirty()) zx::vw::print(zx::vw::lots(), { zx::vw::overlay().width, zx::vw::overlay().height }, zx::vw::path());
+        }
+    } else {
+        ZX_SPAN("skip");
+        zx::vw::skip();
+    }
+
+    zx::ck::wait();
+
+    return done;
+}
+
+}
+
+bool
+zx::pl::init (const bool lean) noexcept {
+
+    if (core::running) return true;
+
+    //// SLOTS AT THE CURRENT GEOMETRY - REBUILT AFTER EVERY RELOAD (STAGES ARE STOPPED)
+    const su32 input = vw::input();
+    const su32 lower { vw::image().width, vw::image().height };
+    const u64  frame = u64(input.w) * input.h;
+    const u64  image = u64(lower.w) * lower.h;
+
+    if (0 == frame or 0 == image) {
+        std::fprintf(stderr, "erro: pipeline sem camera\n");
+        return false;
+    }
+
+    core::lean = lean;
+    core::store.resize(lean ? frame : 3 * frame + 6 * image);
+
+    u08 *next = core::store.data();
+
+    for (u32 k = 0; k < (lean ? 1u : 3u); ++k) {
+        core::frames.slot[k] = { input.w, input.h, u32(frame), 0, 0, 0, next };
+        next += frame;
+    }
+
+    for (u32 k = 0; k < (lean ? 0u : 3u); ++k) {
+        core::posts.slot[k].image   = { 0, 0, u32(image), 0, 0, 0, next };
+        core::posts.slot[k].overlay = { 0, 0, u32(image), 0, 0, 0, next + image };
+        next += 2 * image;
+    }
+
+    core::running = true;
+
+    if (lean) return true;
+
+    core::capture = std::thread(local::capture);
+    core::publish = std::thread(local::publish);
+
+    return true;
+}
+
+void
+zx::pl::stop (void) noexcept {
+
+    if (not core::running) return;
+
+    core::running = false;
+
+    if (core::capture.joinable()) core::capture.join();
+    if (core::publish.joinable()) core::publish.join();
+}
+
+bool
+zx::pl::step (void) noexcept {
+
+    if (core::lean) return local::alone();
+
+    if (not core::shot.try_acquire_for(core::nap)) return false;
+
+    while (core::shot.try_acquire()) {}                 // behind: the older frames are gone already
+
+    if (not core::frames.fetch()) return false;
+
+    ZX_SPAN("analysis");
+
+    ck::open();
+    vw::feed(core::frames.front());
+    ck::shut(vw::idle());
+
+    core::result& post = core::posts.back();
+
+    local::clone(vw::image(),   post.image);
+    local::clone(vw::overlay(), post.overlay);
+
+    post.lots = vw::lots();
+    post.svg  = vw::path();
+
+    core::posts.publish();
+
+    if (vw::dirty()) core::print.store(true, std::memory_order_release);
+
+    core::sent.release();
+
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef __ZX_FRAME_PIPELINE_HPP__
+#define __ZX_FRAME_PIPELINE_HPP__ 1
+
+#include "defs.hpp"
+
+namespace zx::pl
+{
+    //// CAPTURE -> ANALYSIS -> PUBLISH - frame N+1 is read while N is analysed and N-1 published
+    ////
+    //// capture and publish own a thread each, analysis runs on the caller (step) next to the
+    //// command loop. stages hand over through triple buffers: nobody waits on a slower stage,
+    //// it just gets the newest frame when it comes back. lean runs the stages in a row on
+    //// the caller with a single capture buffer, like the loop before the pipeline.
+    bool init (const bool) noexcept ;   // after vw::init and the publishers: buffers, threads (lean: none)
+    void stop (void) noexcept ;         // join capture and publish (reload runs in between)
+    bool step (void) noexcept ;         // analyse the newest frame, false after a short wait for one
+}
+
+#endif
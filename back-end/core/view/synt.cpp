@@ -0,0 +1,161 @@
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "synt.hpp"
+#include "nccp.hpp"
+
+namespace core {
+    static constexpr zx::u08  ground {96};  // asphalt
+    static constexpr zx::u08  paint  {235}; // marker strokes
+    static constexpr zx::u08  inked  {20};  // marker background
+    static constexpr zx::u08  colour[4] {35, 70, 165, 215}; // car bodies
+}
+
+//// blocky asphalt texture - the same on every frame
+static zx::u08
+asphalt (const zx::u32 x, const zx::u32 y) noexcept {
+    const zx::u32 h = ((x >> 2) * 73856093u ^ (y >> 2) * 19349663u) * 0x9E3779B1u;
+    return zx::u08(core::ground + (h >> 28) - 8);
+}
+
+//// marker side, upper left corner at (x, y), rotated around its centre
+static void
+glyph (const zx::view& dst, const zx::u32 kernel, const zx::u32 x, const zx::u32 y, const zx::u32 cell, const zx::f32 turn) noexcept {
+
+    using zx::u32, zx::f32;
+
+    const f32 side = f32(5 * cell);
+    const f32 cx   = f32(x) + side * 0.5f;
+    const f32 cy   = f32(y) + side * 0.5f;
+    const f32 rad  = turn * 3.14159265f / 180.0f;
+    const f32 cs   = std::cos(rad);
+    const f32 sn   = std::sin(rad);
+    const f32 half = side * 0.7072f + 1.0f; // rotated square fits in this radius
+
+    const zx::ru32 box = dst.clip({ u32(std::max(0.0f, cx - half)), u32(std::max(0.0f, cy - half)), u32(2.0f * half), u32(2.0f * half) });
+
+    for (u32 j = box.y; j < box.y + box.h; ++j) {
+        for (u32 i = box.x; i < box.x + box.w; ++i) {
+
+            const f32 dx = f32(i) + 0.5f - cx;
+            const f32 dy = f32(j) + 0.5f - cy;
+            const f32 u  =  cs * dx + sn * dy + side * 0.5f;
+            const f32 v  = -sn * dx + cs * dy + side * 0.5f;
+
+            if (u < 0.0f or v < 0.0f or u >= side or v >= side) continue;
+
+            const u32 k = u32(v) / cell * 5 + u32(u) / cell;
+
+            dst.at(i, j) = zx::tm::kernel[kernel][k] ? core::paint : core::inked;
+        }
+    }
+}
+
+//// car body with a darker windshield band, inset from the markers
+static void
+car (const zx::view& dst, const zx::ru32& bay, const zx::u32 side, const zx::u32 tone) noexcept {
+
+    using zx::u32;
+
+    if (bay.w <= 2 * side or bay.h <= 2 * side) return;
+
+    const zx::ru32 body = dst.clip({ bay.x + side / 2, bay.y + side, bay.w - side, bay.h - 2 * side });
+    const zx::view fill = dst.crop(body);
+
+    for (u32 j = 0; j < fill.height; ++j) {
+        const bool glass = j > fill.height / 4 and j < 2 * fill.height / 5;
+        std::memset(fill.row(j), glass ? 45 : core::colour[tone & 3], fill.width);
+    }
+}
+
+std::vector<zx::ru32>
+zx::sg::grid (const su32 size, const su32 bays, const u32 margin) noexcept {
+
+    std::vector<ru32> out {};
+
+    if (0 == bays.w or 0 == bays.h or size.w <= 2 * margin or size.h <= 2 * margin) return out;
+
+    const u32 pw = (size.w - 2 * margin) / bays.w; // pitch
+    const u32 ph = (size.h - 2 * margin) / bays.h;
+
+    if (pw <= margin or ph <= margin) return out;
+
+    for (u32 r = 0; r < bays.h; ++r)
+        for (u32 c = 0; c < bays.w; ++c)
+            out.push_back({ margin + c * pw, margin + r * ph, pw - margin, ph - margin });
+
+    return out;
+}
+
+std::vector<zx::match>
+zx::sg::mark (const scene& s) noexcept {
+
+    std::vector<match> out {};
+    const u32 side = 5 * s.cell;
+
+    for (const ru32& b : s.bays) {
+        if (b.w < side or b.h < side) continue;
+        out.push_back({ 0, 1.0f, 0, { b.x, b.y, side, side } });
+        out.push_back({ 1, 1.0f, 0, { b.x + b.w - side, b.y + b.h - side, side, side } });
+    }
+
+    return out;
+}
+
+void
+zx::sg::draw (const scene& s, const u32 frame, const view& dst) noexcept {
+
+    const u32 side = 5 * s.cell;
+
+    for (u32 j = 0; j < dst.height; ++j) {
+        u08 *line = dst.row(j);
+        for (u32 i = 0; i < dst.width; ++i) line[i] = asphalt(i, j);
+    }
+
+    //// CARS - TONE FIXED PER BAY SO A PARKED CAR DOES NOT FLICKER
+    for (u32 b = 0; b < s.bays.size(); ++b) {
+        if (b < s.busy.size() and s.busy[b])
+            car(dst, s.bays[b], side, (s.seed * 2654435761u + b * 40503u) >> 13);
+    }
+
+    for (const match& m : mark(s))
+        glyph(dst, m.mask, m.area.x, m.area.y, s.cell, s.turn);
+
+    //// LIGHTING AND SENSOR NOISE
+    std::mt19937                    rng { s.seed * 7919u + frame };
+    std::normal_distribution<f32>   gauss { 0.0f, s.noise > 0.0f ? s.noise : 1.0f };
+
+    const f32 fall = dst.width ? s.shade / f32(dst.width) : 0.0f;
+
+    for (u32 j = 0; j < dst.height; ++j) {
+        u08 *line = dst.row(j);
+        for (u32 i = 0; i < dst.width; ++i) {
+            f32 v = (f32(line[i]) * s.gain + s.bias) * (1.0f - fall * f32(i));
+            if (s.noise > 0.0f) v += gauss(rng);
+            line[i] = u08(v < 0.0f ? 0.0f : v > 255.0f ? 255.0f : v + 0.5f);
+        }
+    }
+}
+
+void
+zx::sg::pack (const view& src, u08* dst) noexcept {
+    for (u32 j = 0; j < src.height; ++j) {
+        const u08 *line = src.row(j);
+        for (u32 i = 0; i < src.width; ++i) {
+            *dst++ = line[i]; //// [Y][U][Y][V]
+            *dst++ = 128;
+        }
+    }
+}
+
+void
+zx::sg::luma (const u08* src, const view& dst) noexcept {
+    for (u32 j = 0; j < dst.height; ++j) {
+        u08 *line = dst.row(j);
+        for (u32 i = 0; i < dst.width; ++i) {
+            line[i] = src[2 * (u64(j) * dst.width + i)];
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef __ZX_SYNTHETIC_SCENE_GENERATOR_HPP__
+#define __ZX_SYNTHETIC_SCENE_GENERATOR_HPP__ 1
+
+#include <vector>
+#include "defs.hpp"
+
+namespace zx::sg
+{
+    //// PARKING SCENE - tm::kernel markers in the bay corners, cars cover the bay
+    struct scene final {
+        su32 size  {1280, 720};   // frame size (camera pixels)
+        u32  cell  {6};           // marker cell, markers are 5x5 cells
+        f32  turn  {0.0f};        // marker rotation (degrees)
+        f32  noise {0.0f};        // sensor noise sigma (gray levels)
+        f32  gain  {1.0f};        // lighting: value * gain + bias
+        f32  bias  {0.0f};
+        f32  shade {0.0f};        // left to right falloff (0..1)
+        u32  seed  {1};           // noise and car colours
+        std::vector<ru32> bays {};
+        std::vector<u08>  busy {}; // one per bay, 1 = car
+    };
+
+    std::vector<ru32>  grid (const su32, const su32, const u32) noexcept ; // frame size, cols x rows, margin
+    std::vector<match> mark (const scene&) noexcept ; // marker areas, mask = kernel index (ground truth)
+
+    void draw (const scene&, const u32, const view&) noexcept ; // frame number (noise), gray output
+    void pack (const view&, u08*)       noexcept ; // gray -> yuyv 4:2:2, neutral chroma
+    void luma (const u08*, const view&) noexcept ; // yuyv 4:2:2 -> gray
+}
+
+#endif
@@ -1,124 +1,734 @@
 
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <sstream>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 #include "view.hpp"
 #include "drvr.hpp"
 #include "nccp.hpp"
+#include "heap.hpp"
+#include "elog.hpp"
+#include "aggr.hpp"
+#include "task.hpp"
+#include "trce.hpp"
 
 namespace core {
 
     using parking = std::vector<zx::match>;
 
-    static zx::graph graph {};      // full image
-    static zx::graph gecho {};      // previous lower resolution image
+    //// EMPTY LOT PIXELS, PACKED - after a tune to a finer grid the model keeps its old one:
+    //// the source is sampled on that grid until the lot is seen free, then it is taken again
+    struct model final {
+        zx::su32             size {};
+        zx::ru32             area {}; // pixels it covers in the current geometry
+        zx::su32             grid {}; // low res size it was sampled on, none = the current one
+        zx::ru32             from {}; // its pixels on that grid
+        std::vector<zx::u08> data {};
+    };
+
+    //// BAY SHAPE FROM THE LAYOUT - RASTERISED ONCE INTO ROW RUNS, STATISTICS WALK ONLY THEM
+    struct mask final {
+        zx::ru32             area {}; // polygon bound, low res
+        std::vector<zx::run> runs {}; // covered pixels, relative to area (none: lot rectangle)
+    };
+
     static zx::graph deres {};      // actual   lower resoultion image
+    static zx::graph prior {};      // last frame lower resolution image, no overlay (motion gating)
+    static zx::graph tmap  {};      // tile change map, one byte per tile
     static parking   lots  {};
     static parking   sets  {};
-    static zx::su32  vsize {};      // view   size
     static zx::su32  csize {};      // camera size
     static zx::su32  block { 2, 2}; // block  size
     static zx::su32  glyph {15,15}; // glyph size
+    static zx::u32   octave{1};     // glyph sizes per octave, markers from half to twice the glyph
+    static zx::su32  tsize {16,16}; // motion tile size
+    static zx::u32   still { 6};    // mean abs change per pixel below which a tile is static
+    static zx::f32   clip  {0.005f};// histogram tail ignored by norm (glare, dead pixels)
+    static zx::u32   sweep {64};    // frames between full CHECK passes (slow light drift)
+    static zx::u32   count {};      // frames since last full CHECK pass
+    static zx::u32   moved {};      // changed tiles in last CHECK frame
+    static bool      fresh {};      // force a full CHECK pass
     static zx::su32  lower {};      // lower resolution image size (640/blockx480/block);
+    static zx::u64   arena {};      // arena mark taken at init
+    static zx::u64   shape {};      // arena mark before the frame buffers (rebuilt by tune)
+    static std::vector<model> empty {}; // per lot, same order as lots
+    static std::vector<mask>  masks {}; // per lot, same order as lots
+    static std::vector<std::vector<zx::pf32>> layout {}; // bay polygons, camera pixels
+    static std::string plan  {};    // layout file loaded
+    static zx::u32   force {};      // configured block, 0 = from source size
+    static zx::f32   busy  {0.25f}; // lot diff above which it is occupied
+    static zx::f32   bounce{0.5f};  // frame diff ignored as camera movement
+    static std::string svg {"/usr/share/nginx/html/face/image.svg"};
     static zx::f32   diff  {};
     static zx::state state {};
     static bool      print {};
+    static zx::ru32  focus {};      // REMAP region, empty = free lots whose markers faded
+    static zx::state after {};      // state resumed once REMAP is done
+    static zx::f32   level {0.80f}; // glyph correlation accepted as a marker
+    static zx::u32   next  {};      // next lot id
+    static bool      camera{};      // frames come from the camera (init), not from feed callers (bind)
+    static bool      lean  {};      // detection keeps one score row per glyph (restart)
+
+    //// CAMERA LOCK - HELD FRAMES NEED NO NORM NOR BOUNCE CHECK, A SAMPLED MEAN WATCHES THE LIGHT
+    static bool      lock  {};      // hold the camera controls from CHECK on
+    static bool      held  {};      // controls held, frames taken as they come
+    static zx::f32   drift {12.0f}; // mean gray change that releases the controls
+    static zx::f32   light {-1.0f}; // mean gray when held, or last frame while auto settles (< 0: none)
+    static zx::u32   calm  {};      // frames auto kept the light steady
+    static zx::u32   settle{30};    // steady frames before holding again
 }
 
-void
-zx::vw::init (const su32 size) noexcept {
+//// lot rectangle plus the bottom-right glyph, clipped to the frame
+static zx::ru32
+bound (const zx::view& frame, const zx::match& lot) noexcept {
+    return frame.clip({ lot.area.x, lot.area.y, lot.area.w + core::glyph.w, lot.area.h + core::glyph.h });
+}
+
+//// area intersection over union
+static zx::f32
+iou (const zx::ru32& a, const zx::ru32& b) noexcept {
+
+    const zx::u32 x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    const zx::u32 x1 = std::min(a.x + a.w, b.x + b.w), y1 = std::min(a.y + a.h, b.y + b.h);
+
+    if (x1 <= x0 or y1 <= y0) return 0.0f;
+
+    const zx::f32 both = zx::f32(x1 - x0) * zx::f32(y1 - y0);
+
+    return both / (zx::f32(a.w) * zx::f32(a.h) + zx::f32(b.w) * zx::f32(b.h) - both);
+}
+
+static bool
+inside (const zx::ru32& a, const zx::ru32& r) noexcept {
+    return a.x >= r.x and a.y >= r.y and a.x + a.w <= r.x + r.w and a.y + a.h <= r.y + r.h;
+}
+
+//// model taken at this bound, scored without resampling
+static bool
+fits (const core::model& m, const zx::ru32& area) noexcept {
+    return 0 == m.grid.w and m.area.x == area.x and m.area.y == area.y and m.area.w == area.w and m.area.h == area.h
+       and m.size.w == area.w and m.size.h == area.h;
+}
+
+//// pixels a lot is judged on - its layout polygon bound, or the lot rectangle
+static zx::ru32
+region (const zx::view& frame, const zx::u64 i) noexcept {
+    return i < core::masks.size() and not core::masks[i].runs.empty() ? core::masks[i].area : bound(frame, core::lots[i]);
+}
+
+//// lot region of this frame into its model, storage reused
+static void
+take (const zx::view& frame, const zx::ru32& area, core::model& m) noexcept {
+
+    const zx::view crop = frame.crop(area);
+
+    m.size = { area.w, area.h };
+    m.area = area;
+    m.grid = {};
+    m.data.resize(zx::u64(area.w) * area.h);
+
+    for (zx::u32 j = 0; j < crop.height; ++j)
+        std::memcpy(m.data.data() + zx::u64(j) * area.w, crop.row(j), area.w);
+}
+
+//// MEAN GRAY OF ONE PIXEL IN 16x16 - CHEAP ENOUGH FOR EVERY FRAME
+static zx::f32
+sample (const zx::view& src) noexcept {
+
+    zx::u64 sum = 0, n = 0;
+
+    for (zx::u32 j = 8; j < src.height; j += 16) {
+        const zx::u08 *s = src.row(j);
+        for (zx::u32 i = 8; i < src.width; i += 16, ++n) sum += s[i];
+    }
+
+    return n ? zx::f32(zx::f64(sum) / zx::f64(n)) : 0.0f;
+}
+
+static void
+hold (void) noexcept {
+    core::held  = zx::wc::cam_lock_impl(true);
+    core::light = -1.0f;                       // reference from the first held frame
+    core::calm  = 0;
+    if (core::held) {
+        std::fprintf(stderr, "info: camera travada, quadros sem normalizacao\n");
+    } else {
+        core::lock = false;                    // until the next reload
+        std::fprintf(stderr, "info: camera sem controles de exposicao, ganho ou balanco\n");
+    }
+}
+
+static void
+release (void) noexcept {
+    zx::wc::cam_lock_impl(false);
+    core::held  = false;
+    core::light = -1.0f;
+    core::calm  = 0;
+    core::fresh = true;                        // normalised frames from here on
+}
+
+//// BRIGHTNESS MONITOR - HELD: A DRIFT FROM THE REFERENCE GIVES THE CAMERA BACK TO AUTO,
+//// AUTO: ONCE THE LIGHT STAYS STEADY FOR settle FRAMES THE CONTROLS ARE HELD AGAIN
+static void
+watch (const zx::view& source) noexcept {
+
+    const zx::f32 now = sample(source);
+    const zx::f32 was = core::light;
+
+    if (was < 0.0f) {
+        core::light = now;
+        return;
+    }
+
+    if (core::held) {
+        if (std::abs(now - was) <= core::drift) return;
+        release();
+        core::light = now;
+        std::fprintf(stderr, "info: brilho mudou (%.0f -> %.0f), camera em automatico\n", zx::f64(was), zx::f64(now));
+        return;
+    }
+
+    core::calm  = std::abs(now - was) < 1.0f ? core::calm + 1 : 0;
+    core::light = now;
+
+    if (core::calm >= core::settle) hold();
+}
+
+//// SCANLINE FILL AT PIXEL CENTRES, EVEN-ODD - LOW RES POLYGON INTO ROW RUNS
+static core::mask
+raster (const zx::view& frame, const std::vector<zx::pf32>& poly) noexcept {
+
+    using zx::u32, zx::i64, zx::f32;
+
+    core::mask m {};
+
+    f32 x0 = poly[0].x, x1 = poly[0].x, y0 = poly[0].y, y1 = poly[0].y;
+    for (const zx::pf32& p : poly) {
+        x0 = std::min(x0, p.x); x1 = std::max(x1, p.x);
+        y0 = std::min(y0, p.y); y1 = std::max(y1, p.y);
+    }
+
+    const auto pixel = [](const f32 v, const u32 top) { return u32(std::clamp<i64>(i64(std::floor(v)), 0, top)); };
+
+    m.area.x = pixel(x0, frame.width);
+    m.area.y = pixel(y0, frame.height);
+    m.area.w = pixel(std::ceil(x1), frame.width)  - m.area.x;
+    m.area.h = pixel(std::ceil(y1), frame.height) - m.area.y;
+
+    std::vector<f32> cross {};
+
+    for (u32 y = m.area.y; y < m.area.y + m.area.h; ++y) {
+
+        const f32 cy = f32(y) + 0.5f;
+
+        cross.clear();
+        for (std::size_t k = 0; k < poly.size(); ++k) {
+            const zx::pf32& a = poly[k];
+            const zx::pf32& b = poly[(k + 1) % poly.size()];
+            if ((a.y <= cy) != (b.y <= cy)) cross.push_back(a.x + (cy - a.y) * (b.x - a.x) / (b.y - a.y));
+        }
+
+        std::sort(cross.begin(), cross.end());
+
+        for (std::size_t k = 0; k + 1 < cross.size(); k += 2) {
+            const i64 from = std::max<i64>(i64(std::ceil(cross[k] - 0.5f)), m.area.x);
+            const i64 to   = std::min<i64>(i64(std::floor(cross[k + 1] - 0.5f)), i64(m.area.x + m.area.w) - 1);
+            if (to >= from) m.runs.push_back({ y - m.area.y, u32(from) - m.area.x, u32(to - from + 1) });
+        }
+    }
+
+    return m;
+}
+
+//// LAYOUT POLYGON PER LOT - THE ONE WHOSE CENTRE LIES IN THE LOT, SMALLEST LOT FIRST WINS
+static void
+outline (void) noexcept {
+
+    using zx::u32, zx::f32;
+
+    const zx::view frame = core::deres;
+
+    core::masks.assign(core::lots.size(), core::mask {});
+
+    for (const std::vector<zx::pf32>& bay : core::layout) {
+
+        std::vector<zx::pf32> poly {};
+        zx::pf32              mid  {};
+
+        for (const zx::pf32& p : bay) {
+            poly.push_back({ p.x / f32(core::block.w), p.y / f32(core::block.h) });
+            mid.x += poly.back().x / f32(bay.size());
+            mid.y += poly.back().y / f32(bay.size());
+        }
+
+        std::size_t best  = core::lots.size();
+        zx::u64     least = ~zx::u64(0);
+
+        for (std::size_t i = 0; i < core::lots.size(); ++i) {
+            const zx::ru32 b = bound(frame, core::lots[i]);
+            if (not core::masks[i].runs.empty() or mid.x < f32(b.x) or mid.y < f32(b.y) or mid.x >= f32(b.x + b.w) or mid.y >= f32(b.y + b.h)) continue;
+            if (zx::u64(b.w) * b.h < least) { least = zx::u64(b.w) * b.h; best = i; }
+        }
+
+        if (best < core::lots.size()) core::masks[best] = raster(frame, poly);
+    }
+}
+
+//// one bay per line, x y pairs in camera pixels, # comments
+static void
+load (const std::string& path) noexcept {
+
+    core::plan = path;
+    core::layout.clear();
 
-    wc::cam_init_impl("/dev/video0");
+    if (path.empty()) return;
 
-    core::vsize = size;
-    core::csize = wc::cam_info_impl();
+    std::ifstream file(path);
+
+    if (not file) {
+        std::fprintf(stderr, "erro: layout %s ausente, vagas retangulares\n", path.c_str());
+        return;
+    }
+
+    std::string line {};
+    zx::u32     row  {0};
+
+    while (std::getline(file, line)) {
+
+        ++row;
+
+        const std::size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        std::istringstream   in(line);
+        std::vector<zx::f32> v  {};
+        zx::f32              n  {};
+
+        while (in >> n) v.push_back(n);
+
+        if (v.empty() and in.eof()) continue;
+
+        if (not in.eof() or v.size() % 2 or v.size() < 6) {
+            std::fprintf(stderr, "erro: %s:%u poligono invalido\n", path.c_str(), row);
+            continue;
+        }
+
+        std::vector<zx::pf32> poly {};
+        for (std::size_t k = 0; k < v.size(); k += 2) poly.push_back({ v[k], v[k + 1] });
+
+        core::layout.push_back(std::move(poly));
+    }
+
+    std::fprintf(stderr, "info: layout %s, %zu vagas\n", path.c_str(), core::layout.size());
+}
+
+//// REMAP - DETECT ONLY IN THE FOCUS REGION, OR AROUND FREE LOTS WHOSE MARKERS FADED,
+//// THEN MERGE: MARKERS OUTSIDE THE REGIONS ARE KEPT, SURVIVING LOTS KEEP THEIR ID
+static void
+patch (void) noexcept {
+
+    using namespace zx;
+
+    const view frame = core::deres;
+    const u32  g     = core::glyph.w;
+
+    std::vector<ru32> regions {};
+
+    if (core::focus.w and core::focus.h) {
+        regions.push_back(frame.clip(core::focus));
+    } else {
+        for (const match& lot : core::lots) {
+
+            if (lot.busy) continue;                   // a car over the markers, not a faded paint
+
+            const pu32 tl { lot.area.x + 1, lot.area.y + 1 };
+            const pu32 br { lot.area.x + lot.area.w - 1, lot.area.y + lot.area.h - 1 };
+
+            if (std::min(tm::score(core::deres, 0, tl), tm::score(core::deres, 1, br)) >= core::level) continue;
+
+            const u32 sx = lot.area.x > g ? lot.area.x - g : 0;
+            const u32 sy = lot.area.y > g ? lot.area.y - g : 0;
+
+            regions.push_back(frame.clip({ sx, sy, lot.area.x + lot.area.w + 2 * g - sx, lot.area.y + lot.area.h + 2 * g - sy }));
+        }
+    }
+
+    if (regions.empty()) return;
+
+    //// MARKERS - OLD ONES OUTSIDE EVERY REGION, NEW ONES FROM EACH REGION
+    std::vector<match> sets {};
+
+    for (const match& m : core::sets) {
+        bool kept = true;
+        for (const ru32& r : regions) kept = kept and not inside(m.area, r);
+        if (kept) sets.push_back(m);
+    }
+
+    for (const ru32& r : regions) {
+        tm::scan(core::deres, core::level, r);
+        for (const match& m : tm::matches()) {
+            bool seen = false;                        // overlapping regions
+            for (const match& s : sets) seen = seen or (s.mask == m.mask and s.area.x == m.area.x and s.area.y == m.area.y);
+            if (not seen) sets.push_back(m);
+        }
+    }
+
+    //// LOTS - MOSTLY THE SAME AREA KEEPS THE ID, EXACTLY THE SAME ALSO STATE AND MODEL
+    std::vector<match>       lots = tm::pair(sets);
+    std::vector<bool>        used(core::lots.size(), false);
+    std::vector<bool>        seen(lots.size(), false);   // new or moved: the model is taken below
+    std::vector<core::model> empty(lots.size());
+
+    for (u64 k = 0; k < lots.size(); ++k) {
+
+        match& lot  = lots[k];
+        i64    best = -1;
+        f32 most = 0.5f;
+
+        for (u32 i = 0; i < core::lots.size(); ++i) {
+            const f32 o = used[i] ? 0.0f : iou(lot.area, core::lots[i].area);
+            if (o >= most) { most = o; best = i64(i); }
+        }
+
+        if (best >= 0) {
+            const match& old = core::lots[u64(best)];
+            used[u64(best)] = true;
+            lot.id = old.id;
+
+            if (old.area.x == lot.area.x and old.area.y == lot.area.y and old.area.w == lot.area.w and old.area.h == lot.area.h) {
+                lot.busy  = old.busy;
+                lot.score = old.score;
+                if (u64(best) < core::empty.size()) empty[k] = std::move(core::empty[u64(best)]);
+                continue;
+            }
+
+            if (old.busy) {                           // markers visible again: the bay is free
+                lg::push(old.id, 0, 0.0f);
+                ag::push(old.id, 0);
+            }
+        } else {
+            lot.id = core::next++;
+        }
+
+        seen[k] = true;
+    }
+
+    //// NOT FOUND AGAIN - A PARKED CAR MAY HIDE THE MARKERS, OTHERWISE THE BAY IS GONE
+    for (u32 i = 0; i < core::lots.size(); ++i) {
+
+        if (used[i]) continue;
+
+        const match& old = core::lots[i];
+
+        if (not old.busy) {
+            ag::drop(old.id);
+            continue;
+        }
+
+        lots.push_back(old);
+        empty.push_back(i < core::empty.size() ? std::move(core::empty[i]) : core::model {});
+
+        for (const match& m : core::sets) {
+            const bool tl = m.mask == 0 and m.area.x <= old.area.x + 1 and m.area.y <= old.area.y + 1
+                                        and m.area.x + 1 >= old.area.x and m.area.y + 1 >= old.area.y;
+            const u32  bx = old.area.x + old.area.w - 1 + g, by = old.area.y + old.area.h - 1 + g; // bottom-right corner
+            const bool br = m.mask == 1 and m.area.x + m.area.w <= bx + 1 and m.area.y + m.area.h <= by + 1
+                                        and m.area.x + m.area.w + 1 >= bx and m.area.y + m.area.h + 1 >= by;
+            bool seen = false;
+            for (const match& s : sets) seen = seen or (s.mask == m.mask and s.area.x == m.area.x and s.area.y == m.area.y);
+            if ((tl or br) and not seen) sets.push_back(m);
+        }
+    }
+
+    ag::grow(core::next);
+
+    core::sets  = sets;
+    core::lots  = lots;
+    core::empty = std::move(empty);
+    core::print = true;
+
+    outline();
+
+    for (u64 k = 0; k < seen.size(); ++k)
+        if (seen[k]) take(frame, region(frame, k), core::empty[k]);   // empty bay is the model
+}
+
+//// BLOCK FROM THE SOURCE SIZE - LOWER RESOLUTION STAYS AROUND 640 WIDE
+//// a camera decodes (MJPG DCT) or decimates (YUYV) only by 1/2, 1/4 and 1/8: the automatic
+//// block is the largest of those not above the estimate, so the gray frame already is the
+//// low res one (1080p: 960x540 instead of a 960 decode resampled to 640 on every frame)
+static zx::su32
+scale (const zx::su32 size) noexcept {
+    zx::u32 block = core::force ? core::force : (size.w + 320) / 640;
+    if (core::camera and not core::force) block = block >= 8 ? 8 : block >= 4 ? 4 : 2;
+    return { block > 2 ? block : 2, block > 2 ? block : 2 };
+}
+
+//// frame buffers for a source of csize pixels, block already set
+static void
+setup (const zx::su32 csize) noexcept {
+
+    core::shape = zx::mm::mark();               // tune drops everything above
+    core::csize = csize;
     core::lower = { core::csize.w / core::block.w, core::csize.h / core::block.h };
 
-    core::graph.width  = size.w;
-    core::graph.height = size.h;
-    core::graph.size   = size.w * size.h;
-    core::graph.data   = new u08[core::graph.size];
+    core::deres = zx::mm::image(core::lower);
+    core::prior = zx::mm::image(core::lower);
+    core::tmap  = zx::mm::image({ (core::lower.w + core::tsize.w - 1) / core::tsize.w,
+                                  (core::lower.h + core::tsize.h - 1) / core::tsize.h });
+
+    core::state = zx::state::NONE;
+    core::count = 0;
+    core::moved = 0;
+    core::fresh = false;
 
-    core::deres.width  = core::lower.w;
-    core::deres.height = core::lower.h;
-    core::deres.size   = core::lower.w * core::lower.h;
-    core::deres.data   = new u08[core::deres.size];
+    zx::tm::init(core::glyph, core::lower, core::lean, core::octave);
+}
+
+void
+zx::vw::init (const char* device, const su32 size, const u32 rate) noexcept {
+
+    core::arena  = mm::mark();
+    core::camera = true;
+
+    wc::cam_init_impl(device, { size, rate, wc::pixel::MJPG });
 
-    core::gecho.width  = core::lower.w;
-    core::gecho.height = core::lower.h;
-    core::gecho.size   = core::lower.w * core::lower.h;
-    core::gecho.data   = new u08[core::gecho.size];
+    core::block = scale(wc::cam_info_impl());
 
-    core::state        = zx::state::NONE;
+    wc::cam_link_impl(core::block.w);          // decode lands near lower size
 
-    tm::init(core::glyph, core::lower);
+    setup(wc::cam_info_impl());
 }
 
 void
-zx::vw::size (const su32 size) noexcept {
-    core::vsize = size;
+zx::vw::bind (const su32 size) noexcept {
 
-    if (nullptr != core::graph.data)
-        delete [] core::graph.data;
+    core::arena  = mm::mark();
+    core::camera = false;
+    core::block  = scale(size);
 
-    core::graph.width  = size.w;
-    core::graph.height = size.h;
-    core::graph.size   = size.w * size.h;
-    core::graph.data   = new u08[core::graph.size];
+    setup(size);
 }
 
 void
-zx::vw::stop (void) noexcept {
+zx::vw::tune (const cf::conf& conf) noexcept {
+
+    core::level  = conf.level;
+    core::busy   = conf.busy;
+    core::bounce = conf.bounce;
+    core::svg    = conf.svg;
+    core::lock   = conf.lock;
+    core::drift  = conf.drift;
+
+    if (core::held and not core::lock) release();
+
+    const su32 glyph { conf.glyph, conf.glyph };
 
-    wc::cam_stop_impl();
+    core::force = conf.block;
 
-    delete [] core::graph.data;
-    delete [] core::deres.data;
-    delete [] core::gecho.data;
+    if (conf.layout != core::plan) {
+        load(conf.layout);
+        if (nullptr != core::deres.data) outline(); // reshaped lots take their model again once free
+    }
+
+    if (nullptr == core::deres.data) {          // before init / bind
+        core::glyph  = glyph;
+        core::octave = conf.scales;
+        core::lean   = conf.lean;
+        return;
+    }
+
+    const su32 block = scale(core::csize);
+
+    if (block.w == core::block.w and glyph.w == core::glyph.w and conf.scales == core::octave) return;
+
+    //// GEOMETRY - KEEP STATE, LOTS AND MODELS, RESCALED TO THE NEW LOW RES
+    const su32       lower = core::lower;
+    const su32       old   = core::block;
+    const zx::state  state = core::state;
+    std::vector<u08> frame(core::prior.data, core::prior.data + core::prior.size);
+
+    const graph saved { lower.w, lower.h, lower.w * lower.h, 0, 0, 0, frame.data() };
+
+    tm::stop();
+    mm::drop(core::shape);
+
+    core::block  = block;
+    core::glyph  = glyph;
+    core::octave = conf.scales;
+
+    setup(core::csize);
+
+    copy(saved, core::prior);
+
+    auto rescale = [&](ru32& a) {
+        a = { a.x * old.w / block.w, a.y * old.h / block.h, a.w * old.w / block.w, a.h * old.h / block.h };
+    };
+
+    for (match& m : core::sets) rescale(m.area);   // markers keep their size, whatever scale found them
+    for (match& m : core::lots) rescale(m.area);
+
+    outline();
+
+    //// MODELS KEEP THEIR PIXELS - A COARSER GRID DOWNSAMPLES THEM (EXACT), A FINER ONE KEEPS
+    //// THE OLD GRID AND THE SOURCE IS SAMPLED ON IT UNTIL THE LOT IS SEEN FREE (AN UPSAMPLED
+    //// MODEL IS BLURRED, THE LOW RES FRAME RESAMPLED AGAIN NEVER LINES UP WITH IT)
+    auto ox = [&](const u32 x) { return x * lower.w / core::lower.w; };   // old pixel a new one samples,
+    auto oy = [&](const u32 y) { return y * lower.h / core::lower.h; };   // as the frame is resampled
+
+    for (core::model& m : core::empty) {
+
+        const ru32 was = m.area;
+
+        rescale(m.area);
+        m.area = view(core::deres).clip(m.area);
 
-    core::graph.data = nullptr;
+        if (0 == m.grid.w and block.w < old.w and m.size.w == was.w and m.size.h == was.h and not m.data.empty()) {
+            m.grid = lower;
+            m.from = was;
+        }
+
+        if (block.w <= old.w or m.grid.w or m.size.w != was.w or m.size.h != was.h) continue;
+
+        //// NEW PIXELS SAMPLING INSIDE THE MODEL - A FLOORED ORIGIN WOULD SHIFT IT HALF A PIXEL
+        u32 x0 = m.area.x, y0 = m.area.y;
+        while (x0 < core::lower.w and ox(x0) < was.x) ++x0;
+        while (y0 < core::lower.h and oy(y0) < was.y) ++y0;
+
+        u32 x1 = x0, y1 = y0;
+        while (x1 < core::lower.w and ox(x1) < was.x + was.w) ++x1;
+        while (y1 < core::lower.h and oy(y1) < was.y + was.h) ++y1;
+
+        m.area = { x0, y0, x1 - x0, y1 - y0 };
+        m.size = { m.area.w, m.area.h };
+
+        std::vector<u08> down(u64(m.area.w) * m.area.h);
+        for (u32 j = 0; j < m.area.h; ++j)
+            for (u32 k = 0; k < m.area.w; ++k)
+                down[u64(j) * m.area.w + k] = m.data[u64(oy(y0 + j) - was.y) * was.w + ox(x0 + k) - was.x];
+        m.data.swap(down);
+    }
+
+    core::state = state;
+    core::fresh = true;
+    core::print = true;
+
+    std::fprintf(stderr, "info: bloco %u glifo %u, imagem %ux%u\n", block.w, glyph.w, core::lower.w, core::lower.h);
+}
+
+void
+zx::vw::stop (void) noexcept {
+
+    if (core::camera) wc::cam_stop_impl();     // controls back to auto
+
+    core::camera     = false;
+    core::held       = false;
+    core::light      = -1.0f;
     core::deres.data = nullptr;
-    core::gecho.data = nullptr;
+    core::prior.data = nullptr;
+    core::tmap.data  = nullptr;
 
     core::lots.clear();
     core::sets.clear();
+    core::empty.clear();
+    core::masks.clear();
 
     tm::stop();
+
+    mm::drop(core::arena);             // next init reuses the same pages
 }
 
 void
-zx::vw::remap(void) noexcept {
+zx::vw::remap(const ru32 area) noexcept {
+    if (core::state != zx::state::REMAP) core::after = core::state;
+    core::focus = area;
     core::state = zx::state::REMAP;
 }
 
 void
 zx::vw::update(void) noexcept {
+    if (core::held) release();                 // the empty site is taken under auto exposure
     core::state = zx::state::UPDATE;
 }
 
 void
 zx::vw::check(void) noexcept {
     core::state = zx::state::CHECK;
+    core::fresh = true;
+    if (core::camera and core::lock) hold();   // calibrated: keep the camera where auto left it
 }
 
 void
-zx::vw::exec (void) noexcept {
+zx::vw::skip (void) noexcept {
+    wc::cam_drop_impl();
+}
 
-    if ( wc::cam_read_impl() ) return;         // skip when busy
+bool
+zx::vw::idle (void) noexcept {
+    return core::state == zx::state::CHECK and 0 == core::moved and not core::fresh;
+}
 
-    copy( wc::cam_gray_impl(), core::deres);   // camera buffer        -> low res
-    norm( core::deres );                       // normaliza cores n..m -> 0..255
+bool
+zx::vw::grab (const graph& dst) noexcept {
+    return not wc::cam_grab_impl(dst);         // false when busy
+}
 
-    if ( core::state == zx::state::UPDATE ) {
+zx::su32
+zx::vw::input (void) noexcept {
+    return wc::cam_gray_impl();
+}
+
+bool
+zx::vw::dirty (void) noexcept {
+    const bool print = core::print;
+    core::print = false;
+    return print;
+}
+
+bool
+zx::vw::feed (const view& source) noexcept {
 
-        core::diff = diff( core::deres, core::gecho); // test image variation -> low res
+    ZX_SPAN("feed");
 
-        copy(core::deres, core::gecho);               // camera buffer echo -> low res
+    {
+        ZX_SPAN("resample");
 
-        if (core::diff > 0.5f) return;                // ignore camera bounce
+        if (core::held) {
+            copy( source, core::deres );               // fixed exposure: frames already comparable
+        } else {
+            u32 hist[256] {};
+            copy( source, core::deres, hist);          // source frame         -> low res + histogram
+            norm( core::deres, hist, core::clip );     // normaliza cores n..m -> 0..255
+        }
+
+        if (core::camera and core::lock and core::state == zx::state::CHECK) watch(source);
+    }
+
+    if ( core::state == zx::state::CHECK ) {
+        ZX_SPAN("motion");
+        core::moved = tile(core::deres, core::prior, core::tmap, core::tsize, core::still); // what moved since last frame
+    }
 
-        tm::proc(core::deres, 0.80f);                 // low res -> image detection
+    if ( core::state == zx::state::UPDATE or core::state == zx::state::REMAP )
+        core::diff = core::held ? 0.0f : diff( core::deres, core::prior ); // camera bounce since last frame
+
+    copy( core::deres, core::prior );              // frame before any overlay
+
+    if ( core::state == zx::state::UPDATE ) {
+
+        if (core::diff > core::bounce) return true;   // ignore camera bounce
+
+        {
+            ZX_SPAN("detect");
+            tm::proc(core::deres, core::level);       // low res -> image detection
+        }
 
         const u64 sets = tm::matches().size();
         const u64 lots = tm::lots().size();
@@ -129,215 +739,447 @@ zx::vw::exec (void) noexcept {
             std::copy(tm::matches().begin(), tm::matches().end(), core::sets.begin());
             std::copy(tm::lots().begin(),    tm::lots().end(),    core::lots.begin());
 
+            for (u32 i = 0; i < lots; ++i) core::lots[i].id = i;
+
+            core::next = u32(lots);
+
+            ag::size(u32(lots));
+
             core::print = true;
         }
 
+        outline();
+
+        //// EMPTY SITE - EVERY LOT MODEL FROM THIS FRAME
+        core::empty.resize(core::lots.size());
+        for (u64 i = 0; i < core::lots.size(); ++i) take(core::deres, region(core::deres, i), core::empty[i]);
+
     } else if ( core::state == zx::state::CHECK ) {
 
-        for (u32 i = 0; i < core::lots.size(); ++i ) {
+        const view frame = core::deres;
+        const view tmap  = core::tmap;
+
+        if (++core::count >= core::sweep) core::fresh = true;
+
+        //// LOT SCORES - INDEPENDENT, READ-ONLY FRAME, STOLEN BY THE WORKERS
+        ZX_SPAN("score");
+
+        tk::loop(u32(core::lots.size()), 4, [&](const u32 begin, const u32 end) {
+            for (u32 i = begin; i < end; ++i) {
+
+                zx::match& lot = core::lots[i];
+
+                const ru32 area = region(frame, i);
+
+                if (0 == area.w or 0 == area.h) continue;
+
+                //// LOT TILES - KEEP LAST SCORE WHEN NOTHING MOVED
+                const ru32 span = tmap.clip({ area.x / core::tsize.w, area.y / core::tsize.h,
+                                              (area.x + area.w - 1) / core::tsize.w - area.x / core::tsize.w + 1,
+                                              (area.y + area.h - 1) / core::tsize.h - area.y / core::tsize.h + 1 });
+                const view tiles = tmap.crop(span);
+
+                bool moved = core::fresh;
+                for (u32 j = 0; j < tiles.height and not moved; ++j)
+                    for (u32 k = 0; k < tiles.width and not moved; ++k)
+                        moved = tiles.at(k, j);
+
+                if (not moved or i >= core::empty.size() or core::empty[i].data.empty()) continue;
+
+                core::model& ref = core::empty[i];          // read only here
+                const view   was { ref.data.data(), ref.size.w, ref.size.h, ref.size.w };
+
+                if (fits(ref, area)) {
+                    const std::vector<run> *runs = i < core::masks.size() ? &core::masks[i].runs : nullptr; // no copy per lot and frame
+                    lot.score = nullptr == runs or runs->empty() ? diff( frame.crop(area), was ) : diff( frame.crop(area), was, *runs );
+                } else if (ref.grid.w) {
+                    //// OLD GRID - SOURCE SAMPLED AS THE FRAME THE MODEL CAME FROM (copy)
+                    std::vector<u08> tmp(ref.data.size());
+                    const view       now { tmp.data(), ref.size.w, ref.size.h, ref.size.w };
+                    for (u32 j = 0; j < ref.size.h; ++j) {
+                        const u08 *line = source.row((ref.from.y + j) * source.height / ref.grid.h);
+                        for (u32 k = 0; k < ref.size.w; ++k) now.at(k, j) = line[(ref.from.x + k) * source.width / ref.grid.w];
+                    }
+                    lot.score = diff(now, was);
+                } else {
+                    //// OLD GEOMETRY - FRAME RESAMPLED TO THE MODEL SIZE
+                    std::vector<u08> tmp(ref.data.size());
+                    const view       now { tmp.data(), ref.size.w, ref.size.h, ref.size.w };
+                    copy(frame.crop(frame.clip(ref.area)), now);
+                    lot.score = diff(now, was);
+                }
+            }
+        });
 
-            zx::match& lot = core::lots[i];
+        //// FREE AT THE OLD GEOMETRY - TAKE THE MODEL FROM THIS FRAME
+        for (u32 i = 0; i < core::empty.size() and i < core::lots.size(); ++i) {
+            const ru32 area = region(frame, i);
+            if (fits(core::empty[i], area) or core::lots[i].score > core::busy) continue;
+            take(frame, area, core::empty[i]);
+        }
 
-            ru32 area = lot.area;
-            area.w += core::glyph.w;
-            area.h += core::glyph.h;
+        for (u32 i = 0; i < core::lots.size(); ++i ) {
+
+            zx::match& lot  = core::lots[i];
+            const ru32 area = region(frame, i);
 
-            lot.score = diff( core::deres, core::gecho, area);
+            if (0 == area.w or 0 == area.h) continue;
 
-            if (lot.score > 0.25f) {
-                if (lot.busy == 0) core::print = true;
+            if (lot.score > core::busy) {
+                if (lot.busy == 0) {
+                    core::print = true;
+                    lg::push(lot.id, 1, lot.score);
+                    ag::push(lot.id, 1);
+                }
                 lot.busy = 1;
-                fill( core::deres, area, 100 );
+                if (i < core::masks.size() and not core::masks[i].runs.empty()) {
+                    for (const run& r : core::masks[i].runs) std::memset(frame.crop(area).row(r.y) + r.x, 100, r.n);
+                } else {
+                    fill( frame.crop(area), 100 );
+                }
             } else {
-                if (lot.busy == 1) core::print = true;
+                if (lot.busy == 1) {
+                    core::print = true;
+                    lg::push(lot.id, 0, lot.score);
+                    ag::push(lot.id, 0);
+                }
                 lot.busy = 0;
             }
         }
 
-        if (core::print) {
-            print();
-            core::print = false;
+        if (core::fresh) {
+            core::fresh = false;
+            core::count = 0;
+        }
+
+    } else if ( core::state == zx::state::REMAP ) {
+
+        if (core::diff > core::bounce) return true;   // ignore camera bounce
+
+        {
+            ZX_SPAN("remap");
+            patch();
         }
+
+        core::state = core::after;
+        core::fresh = true;
     }
 
     if ( core::sets.size() and core::lots.size() ) {
+
+        const view frame = core::deres;
+
         for (const zx::match& m : core::sets) {
-            const ru32 area { m.area.x, m.area.y, m.area.w, m.area.h};
-            rect(core::deres, area, 255);
+            rect(frame.crop(frame.clip(m.area)), 255);
         }
 
-        for (const zx::match& m : core::lots) {
-            const ru32 area { m.area.x,  m.area.y, (m.area.w + core::glyph.w), (m.area.h + core::glyph.h)};
-            quad(core::deres, area, 200);
+        for (u64 i = 0; i < core::lots.size(); ++i) {
+            rect(frame.crop(region(frame, i)), 200);
         }
     }
 
-    copy(core::deres, core::graph);
-}
-
-const zx::graph&
-zx::vw::data (void) noexcept {
-    return core::graph;
+    return true;
 }
 
 void
-zx::vw::fill(const zx::graph& dst, const ru32& area, const u08 color) noexcept {
-    for (u32 j = area.y; j < area.h; ++j) {
-        for (u32 i = area.x; i < area.w; ++i) {
-            const u32 index = j * dst.width + i;
-            dst.data[index] = color;
-        }
+zx::vw::fill(const view& dst, const u08 color) noexcept {
+    for (u32 j = 0; j < dst.height; ++j) {
+        std::memset(dst.row(j), color, dst.width);
     }
 }
 
 void
-zx::vw::rect(const zx::graph& graph, const ru32& area, const u08 color) noexcept {
-    const u32 sx = area.x;
-    const u32 sy = area.y;
-    const u32 ex = area.w + sx;
-    const u32 ey = area.h + sy;
+zx::vw::rect(const view& dst, const u08 color) noexcept {
 
-    for (u32 i = sx; i < ex; ++i) {
-        graph.data[ (sy+0) * graph.width + i ] = color;
-        graph.data[ (ey-1) * graph.width + i ] = color;
-    }
+    if (0 == dst.width or 0 == dst.height) return;
+
+    const u32 ex = dst.width  - 1;
+    const u32 ey = dst.height - 1;
+
+    std::memset(dst.row(0),  color, dst.width);
+    std::memset(dst.row(ey), color, dst.width);
 
-    for (u32 j = sy; j < ey; ++j) {
-        graph.data[ j * graph.width + (sx+0) ] = color;
-        graph.data[ j * graph.width + (ex-1) ] = color;
+    for (u32 j = 0; j < dst.height; ++j) {
+        dst.at( 0, j) = color;
+        dst.at(ex, j) = color;
     }
 }
 
 void
-zx::vw::quad(const zx::graph& graph, const ru32& area, const u08 color) noexcept {
-    const u32 sx = area.x;
-    const u32 sy = area.y;
-    const u32 ex = area.w;
-    const u32 ey = area.h;
+zx::vw::copy(const view& src, const view& dst) noexcept {
 
-    for (u32 i = sx; i < ex; ++i) {
-        graph.data[ (sy+0) * graph.width + i ] = color;
-        graph.data[ (ey-1) * graph.width + i ] = color;
+    if (src.width == dst.width and src.height == dst.height) {
+        for (u32 y = 0; y < dst.height; y++)
+            std::memcpy(dst.row(y), src.row(y), dst.width);
+        return;
     }
 
-    for (u32 j = sy; j < ey; ++j) {
-        graph.data[ j * graph.width + (sx+0) ] = color;
-        graph.data[ j * graph.width + (ex-1) ] = color;
+    for (u32 y = 0; y < dst.height; y++) {
+        const u08 *line = src.row(y * src.height / dst.height);
+        u08       *data = dst.row(y);
+        for (u32 x = 0; x < dst.width; x++) {
+            data[x] = line[x * src.width / dst.width];
+        }
     }
 }
 
+ZX_CLONES
 void
-zx::vw::copy(const zx::graph& src, const zx::graph& dst) noexcept {
+zx::vw::copy(const view& src, const view& dst, u32 (&hist)[256]) noexcept {
     for (u32 y = 0; y < dst.height; y++) {
-        u32 src_y = y * src.height / dst.height;
+        const u08 *line = src.row(y * src.height / dst.height);
+        u08       *data = dst.row(y);
         for (u32 x = 0; x < dst.width; x++) {
-            u32 src_x = x * src.width / dst.width;
-            dst.data[y * dst.width + x] = src.data[src_y * src.width + src_x];
+            const u08 value = line[x * src.width / dst.width];
+            data[x] = value;
+            hist[value] += 1;
         }
     }
 }
 
-zx::f32
-zx::vw::diff(const zx::graph& src, const zx::graph& dst, const ru32& area) noexcept {
-
-    f64 mean1 = 0.0f, mean2 = 0.0f;
-    f64 numerator = 0.0f;
-    f64 denom1 = 0.0f, denom2 = 0.0f;
-    u32 size  = 0;
-
-    for (u32 j = area.y; j < area.h; ++j) {
-        for (u32 i = area.x; i < area.w; ++i) {
-            const u32 index = j * src.width + i;
-            mean1 += src.data[index];
-            mean2 += dst.data[index];
-            ++size;
-        }
-    }
+ZX_CLONES
+zx::u32
+zx::vw::tile(const view& src, const view& dst, const view& map, const su32 size, const u32 limit) noexcept {
+
+    assert(src.width == dst.width and src.height == dst.height);
 
-    mean1 /= size;
-    mean2 /= size;
+    u32 moved = 0;
 
-    for (u32 j = area.y; j < area.h; ++j) {
-        for (u32 i = area.x; i < area.w; ++i) {
-            const u32 index = j * src.width + i;
-            const f64 diff1 = src.data[index] - mean1;
-            const f64 diff2 = dst.data[index] - mean2;
-            numerator += diff1 * diff2;
-            denom1    += diff1 * diff1;
-            denom2    += diff2 * diff2;
+    for (u32 ty = 0; ty < map.height; ++ty) {
+        for (u32 tx = 0; tx < map.width; ++tx) {
+
+            const ru32 area = src.clip({ tx * size.w, ty * size.h, size.w, size.h });
+            const view a    = src.crop(area);
+            const view b    = dst.crop(area);
+
+            u32 sad = 0;
+            for (u32 j = 0; j < a.height; ++j) {
+                const u08 *s = a.row(j);
+                const u08 *d = b.row(j);
+                for (u32 i = 0; i < a.width; ++i) {
+                    sad += u32(s[i] > d[i] ? s[i] - d[i] : d[i] - s[i]);
+                }
+            }
+
+            const u08 flag = sad > limit * area.w * area.h ? 1 : 0;
+
+            map.at(tx, ty) = flag;
+            moved         += flag;
         }
     }
 
-    const f64 denominator = std::sqrt(denom1 * denom2);
+    return moved;
+}
+
+//// 1 - ncc from the pixel moments
+static zx::f32
+ncc (const zx::i64 n, const zx::u64 sx, const zx::u64 sy, const zx::u64 sxx, const zx::u64 syy, const zx::u64 sxy) noexcept {
 
-    if (denominator == 0.0) return 0.0f;
+    using zx::i64, zx::f32, zx::f64;
 
-    f64 ncc = numerator / denominator;
+    const i64 num = n * i64(sxy) - i64(sx) * i64(sy);
+    const i64 va  = n * i64(sxx) - i64(sx) * i64(sx);
+    const i64 vb  = n * i64(syy) - i64(sy) * i64(sy);
 
-    return (1.0f - f32(ncc));
+    if (va <= 0 or vb <= 0) return 0.0f;
+
+    return 1.0f - f32(f64(num) / std::sqrt(f64(va) * f64(vb)));
 }
 
+//// single pass integer moments, exact below ~11M pixels (n * sum xy fits i64)
+ZX_CLONES
 zx::f32
-zx::vw::diff(const zx::graph& src, const zx::graph& dst) noexcept {
+zx::vw::diff(const view& src, const view& dst) noexcept {
+
+    assert(src.width == dst.width and src.height == dst.height);
 
-    f64 mean1 = 0.0f, mean2 = 0.0f;
-    f64 numerator = 0.0f;
-    f64 denom1 = 0.0f, denom2 = 0.0f;
+    const i64 n = i64(src.width) * src.height;
 
-    for (size_t i = 0; i < src.size; ++i) {
-        mean1 += src.data[i];
-        mean2 += dst.data[i];
+    if (0 == n) return 0.0f;
+
+    u64 sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+
+    for (u32 j = 0; j < src.height; ++j) {
+        const u08 *s = src.row(j);
+        const u08 *d = dst.row(j);
+
+        u32 rx = 0, ry = 0, rxx = 0, ryy = 0, rxy = 0; // one row never overflows u32
+
+        for (u32 i = 0; i < src.width; ++i) {
+            rx  += s[i];
+            ry  += d[i];
+            rxx += u32(s[i]) * s[i];
+            ryy += u32(d[i]) * d[i];
+            rxy += u32(s[i]) * d[i];
+        }
+
+        sx += rx; sy += ry; sxx += rxx; syy += ryy; sxy += rxy;
     }
-    mean1 /= src.size;
-    mean2 /= dst.size;
 
-    for (size_t i = 0; i < src.size; ++i) {
-        const f64 diff1 = src.data[i] - mean1;
-        const f64 diff2 = dst.data[i] - mean2;
-        numerator += diff1 * diff2;
-        denom1    += diff1 * diff1;
-        denom2    += diff2 * diff2;
+    return ncc(n, sx, sy, sxx, syy, sxy);
+}
+
+//// same moments over the runs - each run is a contiguous row piece the clones vectorise
+ZX_CLONES
+zx::f32
+zx::vw::diff(const view& src, const view& dst, const std::vector<run>& runs) noexcept {
+
+    assert(src.width == dst.width and src.height == dst.height);
+
+    i64 n = 0;
+    u64 sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+
+    for (const run& r : runs) {
+        const u08 *s = src.row(r.y) + r.x;
+        const u08 *d = dst.row(r.y) + r.x;
+
+        assert(r.x + r.n <= src.width);
+
+        u32 rx = 0, ry = 0, rxx = 0, ryy = 0, rxy = 0; // one row never overflows u32
+
+        for (u32 i = 0; i < r.n; ++i) {
+            rx  += s[i];
+            ry  += d[i];
+            rxx += u32(s[i]) * s[i];
+            ryy += u32(d[i]) * d[i];
+            rxy += u32(s[i]) * d[i];
+        }
+
+        n  += r.n;
+        sx += rx; sy += ry; sxx += rxx; syy += ryy; sxy += rxy;
     }
 
-    const f64 denominator = std::sqrt(denom1 * denom2);
+    if (0 == n) return 0.0f;
+
+    return ncc(n, sx, sy, sxx, syy, sxy);
+}
 
-    if (denominator == 0.0) return 0.0f;
+//// LUT APPLY - AVX2 ONLY WHEN THE CPU HAS IT (function multiversioning)
+#if defined(__x86_64__) and defined(__GNUC__) and not defined(__clang__)
+__attribute__((target("avx2")))
+static void
+apply (const zx::view& src, const zx::u08 (&lut)[256]) noexcept {
 
-    f64 ncc = numerator / denominator;
+    using zx::u32, zx::u08;
 
-    return ( 1.0f - f32(ncc) );
+    __m256i tbl[16];
+    for (u32 k = 0; k < 16; ++k)
+        tbl[k] = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lut + 16 * k)));
+
+    const __m256i bias = _mm256_set1_epi8(0x70);
+    const __m256i base = _mm256_set1_epi8(0x10);
+
+    //// 16 SHUFFLES OF 16 ENTRIES PER 32 PIXELS
+    for (u32 j = 0; j < src.height; ++j) {
+
+        u08 *s = src.row(j);
+        u32  i = 0;
+
+        for (; i + 32 <= src.width; i += 32) {
+
+            __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            __m256i out = _mm256_setzero_si256();
+
+            for (u32 k = 0; k < 16; ++k) {
+                //// 0..15 -> 0x70..0x7F (lookup), 16..255 -> >= 0x80 (zero)
+                out = _mm256_or_si256(out, _mm256_shuffle_epi8(tbl[k], _mm256_adds_epu8(idx, bias)));
+                idx = _mm256_sub_epi8(idx, base);
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(s + i), out);
+        }
+
+        for (; i < src.width; ++i) {
+            s[i] = lut[s[i]];
+        }
+    }
+}
+
+__attribute__((target("default")))
+#endif
+static void
+apply (const zx::view& src, const zx::u08 (&lut)[256]) noexcept {
+    for (zx::u32 j = 0; j < src.height; ++j) {
+        zx::u08 *s = src.row(j);
+        for (zx::u32 i = 0; i < src.width; ++i) {
+            s[i] = lut[s[i]];
+        }
+    }
 }
 
 void
-zx::vw::norm(const zx::graph& src) noexcept {
+zx::vw::norm(const view& src) noexcept {
+
+    u32 hist[256] {};
 
-    u08 max = 0, min = 255;
-    for (u32 i = 0; i < src.size; ++i) {
-        const u08 value = src.data[i];
-        max = value > max ? value : max;
-        min = value < min ? value : min;
+    for (u32 j = 0; j < src.height; ++j) {
+        const u08 *s = src.row(j);
+        for (u32 i = 0; i < src.width; ++i) {
+            hist[s[i]] += 1;
+        }
     }
 
-    for (u32 i = 0; i < src.size; ++i) {
-        src.data[i] = u08((src.data[i] - min) * 255 / (max - min + 1));
+    norm(src, hist, 0.0f);
+}
+
+void
+zx::vw::norm(const view& src, const u32 (&hist)[256], const f32 clip) noexcept {
+
+    //// PERCENTILE BOUNDS - IGNORE clip OF THE PIXELS AT EACH END
+    u64 total = 0;
+    for (u32 v = 0; v < 256; ++v) total += hist[v];
+
+    const u64 tail = u64(f64(total) * f64(clip));
+
+    u32 min = 0, max = 255;
+    u64 sum = 0;
+
+    for (min = 0;   min < 255; ++min) { sum += hist[min]; if (sum > tail) break; }
+    sum = 0;
+    for (max = 255; max > min; --max) { sum += hist[max]; if (sum > tail) break; }
+
+    alignas(32) u08 lut[256];
+
+    for (u32 v = 0; v < 256; ++v) {
+        const u32 c = v < min ? min : (v > max ? max : v);
+        lut[v] = u08((c - min) * 255 / (max - min + 1));
     }
+
+    apply(src, lut);
 }
 
 const std::vector<zx::match>&
 zx::vw::lots(void) noexcept {
-    return tm::lots();
+    return core::lots;
 }
 
+const zx::graph&
+zx::vw::image (void) noexcept {
+    return core::prior;
+}
+
+const zx::graph&
+zx::vw::overlay (void) noexcept {
+    return core::deres;
+}
+
+
+const std::string&
+zx::vw::path (void) noexcept {
+    return core::svg;
+}
 
 void
-zx::vw::print (void) noexcept {
+zx::vw::print (const std::vector<match>& lots, const su32 size, const std::string& path) noexcept {
+
+    ZX_SPAN("svg");
 
-    std::ofstream ofs("/usr/share/nginx/html/face/image.svg", std::ios::binary);
+    std::ofstream ofs(path, std::ios::binary);
 
     std::string svg;
 
-    const u32 wd = core::deres.width;
-    const u32 ht = core::deres.height;
+    const u32 wd = size.w;
+    const u32 ht = size.h;
     const u32 h3 = 3 * (ht / 4);
 
     svg.reserve(768);
@@ -357,12 +1199,12 @@ zx::vw::print (void) noexcept {
     );
     svg += "\n";
 
-    for (const auto m : core::lots) {
+    for (const auto m : lots) {
 
         const u32 sx = m.area.x + 2;
         const u32 sy = m.area.y + 2;
-        const u32 ex = m.area.w - sx - 2;
-        const u32 ey = m.area.h - sy - 2;
+        const u32 ex = m.area.w > 4 ? m.area.w - 4 : 0;
+        const u32 ey = m.area.h > 4 ? m.area.h - 4 : 0;
 
         svg += std::format(
             R"(  <rect x="{}"  y="{}"  width="{}" height="{}" fill="{}"/>)",
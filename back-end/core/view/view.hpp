@@ -1,34 +1,47 @@
 #ifndef __ZX_COMPUTER_VISION_HPP__
 #define __ZX_COMPUTER_VISION_HPP__ 1
 
+#include <string>
 #include <vector>
 #include "defs.hpp"
+#include "conf.hpp"
 
 namespace zx::vw {
 
-    void init (const su32) noexcept;
-    void size (const su32) noexcept;
+    void init (const char*, const su32, const u32) noexcept; // device, requested camera size, frame rate
+    void bind (const su32) noexcept;            // no camera: frames of this size come from feed
+    void tune (const cf::conf&) noexcept;       // thresholds next frame, block/glyph rebuilt in place, layout reloaded
 
     void stop (void) noexcept;
-    void exec (void) noexcept;
-
-    void norm (const graph&)               noexcept;
-    void copy (const graph&, const graph&) noexcept;
-    f32  diff (const graph&, const graph&) noexcept;
-    f32  diff (const graph&, const graph&, const ru32&) noexcept;
-    void fill (const graph&, const ru32&,  const u08  ) noexcept;
-    void rect (const zx::graph&, const ru32&, const u08) noexcept ;
-    void quad (const zx::graph&, const ru32&, const u08) noexcept ;
-
-    void remap  (void) noexcept;
+    bool grab (const graph&) noexcept; // camera gray into a capture buffer of input() size, false when none ready or corrupt
+    bool feed (const view&) noexcept; // analyse a gray frame (camera or synthetic)
+    void skip (void) noexcept; // decimated frame: keep camera queue fresh
+    bool idle (void) noexcept; // nothing moved in the last CHECK frame
+
+    void norm (const view&)              noexcept; // min..max -> 0..255
+    void norm (const view&, const u32 (&)[256], const f32) noexcept; // percentile lut
+    void copy (const view&, const view&) noexcept; // nearest neighbour resample
+    void copy (const view&, const view&, u32 (&)[256]) noexcept; // resample + histogram
+    f32  diff (const view&, const view&) noexcept; // 1 - ncc
+    f32  diff (const view&, const view&, const std::vector<run>&) noexcept; // 1 - ncc over the runs only
+    void fill (const view&, const u08)   noexcept;
+    void rect (const view&, const u08)   noexcept; // view outline
+    u32  tile (const view&, const view&, const view&, const su32, const u32) noexcept; // change map
+
+    void remap  (const ru32) noexcept; // empty area: free lots whose markers faded
     void update (void) noexcept;
     void check  (void) noexcept;
 
-    void print  (void) noexcept;
+    bool dirty  (void) noexcept; // lots changed since the last call (svg due)
+    void print  (const std::vector<zx::match>&, const su32, const std::string&) noexcept; // svg of lots on a size frame
+
+    const std::string& path (void) noexcept; // svg file
+    su32 input  (void) noexcept; // camera gray size
 
-    const std::vector<zx::match>& lots    (void)      noexcept ;
+    const std::vector<zx::match>& lots    (void)      noexcept ; // monitored lots with score/busy
 
-    const zx::graph& data (void) noexcept;
+    const zx::graph& image   (void) noexcept; // low res frame, before overlay
+    const zx::graph& overlay (void) noexcept; // low res frame with lot overlay
 
 }
 
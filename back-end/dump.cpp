@@ -0,0 +1,276 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include "heap.hpp"
+#include "task.hpp"
+#include "view.hpp"
+#include "nccp.hpp"
+#include "synt.hpp"
+#include "trce.hpp"
+
+//// SYNTHETIC REGRESSION HARNESS
+//// every case renders a site with sg, runs UPDATE (tm::proc) on the empty
+//// scene and CHECK on scenes with cars, then prints precision / recall and
+//// frames per second. optimisations must leave the counts unchanged. the retune case
+//// reloads a coarser block a third into CHECK and the original one at two thirds, the
+//// layout case judges every bay on a trapezoid inset into it (layout file).
+
+namespace core {
+
+    using clock = std::chrono::steady_clock;
+
+    struct tally final {
+        zx::u32 tp {}, fp {}, fn {};
+
+        zx::f32 precision (void) const noexcept { return tp + fp ? zx::f32(tp) / zx::f32(tp + fp) : 1.0f; }
+        zx::f32 recall    (void) const noexcept { return tp + fn ? zx::f32(tp) / zx::f32(tp + fn) : 1.0f; }
+    };
+
+    struct trial final {
+        const char   *name   {};
+        zx::sg::scene scene  {};
+        zx::u32       retune {};    // block reloaded during CHECK, then back to automatic
+        bool          shape  {};    // bays judged on layout trapezoids
+    };
+
+    static bool      yuyv   {};     // round trip every frame through yuyv 4:2:2
+    static bool      lean   {};     // detection row by row (lean = 1)
+    static zx::u32   frames {48};   // CHECK frames per case
+    static zx::u32   settle {3};    // UPDATE frames per case
+    static const char *trace {};    // chrome trace of every case (TRACE=1 build)
+    static const char *plan  {"/tmp/zx-dump.layout"};
+}
+
+static zx::f64
+since (const core::clock::time_point start) noexcept {
+    return std::chrono::duration<zx::f64, std::milli>(core::clock::now() - start).count();
+}
+
+//// area intersection over union
+static zx::f32
+iou (const zx::ru32& a, const zx::ru32& b) noexcept {
+
+    const zx::u32 x0 = std::max(a.x, b.x), y0 = std::max(a.y, b.y);
+    const zx::u32 x1 = std::min(a.x + a.w, b.x + b.w), y1 = std::min(a.y + a.h, b.y + b.h);
+
+    if (x1 <= x0 or y1 <= y0) return 0.0f;
+
+    const zx::f32 both = zx::f32(x1 - x0) * zx::f32(y1 - y0);
+
+    return both / (zx::f32(a.w) * zx::f32(a.h) + zx::f32(b.w) * zx::f32(b.h) - both);
+}
+
+//// camera pixels -> lower resolution
+static zx::ru32
+lower (const zx::ru32& a, const zx::u32 block) noexcept {
+    return { a.x / block, a.y / block, a.w / block, a.h / block };
+}
+
+//// one trapezoid per bay, narrower at the top, camera pixels
+static bool
+layout (const zx::sg::scene& s) noexcept {
+
+    std::FILE *file = std::fopen(core::plan, "w");
+
+    if (nullptr == file) return false;
+
+    for (const zx::ru32& b : s.bays)
+        std::fprintf(file, "%u %u  %u %u  %u %u  %u %u\n",
+            b.x + b.w / 8,      b.y + b.h / 6,
+            b.x + b.w * 7 / 8,  b.y + b.h / 6,
+            b.x + b.w * 15 / 16, b.y + b.h * 5 / 6,
+            b.x + b.w / 16,     b.y + b.h * 5 / 6);
+
+    return 0 == std::fclose(file);
+}
+
+//// render, optionally through yuyv, then analyse
+static zx::f64
+frame (const zx::sg::scene& s, const zx::u32 tick, const zx::graph& gray, zx::u08* packed) noexcept {
+
+    zx::sg::draw(s, tick, gray);
+
+    if (core::yuyv) {
+        zx::sg::pack(gray, packed);
+        zx::sg::luma(packed, gray);
+    }
+
+    const core::clock::time_point start = core::clock::now();
+    zx::vw::feed(gray);
+    return since(start);
+}
+
+static void
+run (const core::trial& t) noexcept {
+
+    zx::sg::scene s = t.scene;
+
+    const zx::u64 mark   = zx::mm::mark();
+    const zx::graph gray = zx::mm::image(s.size);
+    zx::u08 *packed      = zx::mm::take(zx::u64(s.size.w) * s.size.h * 2);
+
+    zx::vw::bind(s.size);
+
+    const zx::u32 block = s.size.w / zx::vw::image().width;
+
+    if (t.shape and layout(s)) {
+        zx::cf::conf conf {};                       // masks follow the lots found at UPDATE
+        conf.lean   = core::lean;
+        conf.layout = core::plan;
+        zx::vw::tune(conf);
+    }
+
+    //// UPDATE - EMPTY SITE
+    s.busy.assign(s.bays.size(), 0);
+
+    zx::vw::update();
+
+    zx::f64 detect = 0.0;
+    for (zx::u32 f = 0; f < core::settle; ++f) detect = frame(s, f, gray, packed);
+
+    //// MARKERS - SAME KERNEL, CORNER WITHIN A QUARTER GLYPH
+    core::tally marks {};
+    {
+        std::vector<zx::match> truth = zx::sg::mark(s);
+        std::vector<bool>      taken(truth.size(), false);
+
+        for (const zx::match& m : zx::tm::matches()) {
+            bool hit = false;
+            for (std::size_t i = 0; i < truth.size() and not hit; ++i) {
+                const zx::ru32 t = lower(truth[i].area, block);
+                const zx::u32  d = std::max(t.w / 4, 2u);
+                if (taken[i] or truth[i].mask != m.mask) continue;
+                if (std::max(t.x, m.area.x) - std::min(t.x, m.area.x) > d) continue;
+                if (std::max(t.y, m.area.y) - std::min(t.y, m.area.y) > d) continue;
+                taken[i] = hit = true;
+            }
+            hit ? ++marks.tp : ++marks.fp;
+        }
+        for (const bool b : taken) if (not b) ++marks.fn;
+    }
+
+    //// LOTS - IOU WITH THE BAY, DETECTED AREA PLUS THE BOTTOM-RIGHT GLYPH
+    core::tally lots {};
+    std::vector<zx::i32> which(s.bays.size(), -1);    // bay -> vw lot
+    {
+        const std::vector<zx::match>& found = zx::vw::lots();
+        std::vector<bool> taken(found.size(), false);
+
+        for (std::size_t b = 0; b < s.bays.size(); ++b) {
+            const zx::ru32 bay = lower(s.bays[b], block);
+            for (std::size_t l = 0; l < found.size() and which[b] < 0; ++l) {
+                const zx::ru32 area { found[l].area.x, found[l].area.y,
+                                      found[l].area.w + zx::tm::glyph(0).width, found[l].area.h + zx::tm::glyph(0).height };
+                if (taken[l] or iou(bay, area) < 0.5f) continue;
+                taken[l] = true;
+                which[b] = zx::i32(l);
+            }
+            which[b] < 0 ? ++lots.fn : ++lots.tp;
+        }
+        for (const bool b : taken) if (not b) ++lots.fp;
+    }
+
+    //// CHECK - CARS COME AND GO EVERY 8 FRAMES
+    zx::vw::check();
+
+    core::tally busy {};
+    zx::f64 total = 0.0;
+
+    for (zx::u32 f = 0; f < core::frames; ++f) {
+
+        if (t.retune and (f == core::frames / 3 + 4 or f == core::frames * 2 / 3 + 4)) {
+            zx::cf::conf conf {};                   // reload: geometry rebuilt between two frames
+            conf.lean  = core::lean;
+            conf.block = f < core::frames / 2 ? t.retune : 0;
+            zx::vw::tune(conf);
+        }
+
+        const zx::u32 round = f / 8;
+        for (std::size_t b = 0; b < s.bays.size(); ++b)
+            s.busy[b] = ((b * 7 + round * 3) % 5) < 2 ? 1 : 0;
+
+        total += frame(s, core::settle + f, gray, packed);
+
+        for (std::size_t b = 0; b < s.bays.size(); ++b) {
+            if (which[b] < 0) continue;
+            const bool seen = zx::vw::lots()[std::size_t(which[b])].busy;
+            if (seen and s.busy[b])   ++busy.tp;
+            if (seen and !s.busy[b])  ++busy.fp;
+            if (!seen and s.busy[b])  ++busy.fn;
+        }
+    }
+
+    std::printf("%-10s %5u/%-3u %4.2f %4.2f  %2u/%-2u %4.2f %4.2f  %4.2f %4.2f  %8.2f %8.1f\n",
+        t.name, marks.tp, marks.tp + marks.fn, marks.precision(), marks.recall(),
+        lots.tp, lots.tp + lots.fn, lots.precision(), lots.recall(),
+        busy.precision(), busy.recall(),
+        detect, core::frames ? 1000.0 * core::frames / total : 0.0);
+
+    if (t.shape) {
+        zx::cf::conf conf {};                       // next case on lot rectangles again
+        conf.lean = core::lean;
+        zx::vw::tune(conf);
+        std::remove(core::plan);
+    }
+
+    zx::vw::stop();
+    zx::mm::drop(mark);
+}
+
+int main (int argc, char** argv) noexcept
+{
+    for (int a = 1; a < argc; ++a) {
+        if (0 == std::strcmp(argv[a], "-y")) core::yuyv   = true;
+        if (0 == std::strcmp(argv[a], "-l")) core::lean   = true;
+        if (0 == std::strcmp(argv[a], "-n") and a + 1 < argc) core::frames = zx::u32(std::atoi(argv[++a]));
+        if (0 == std::strcmp(argv[a], "-t") and a + 1 < argc) core::trace  = argv[++a];
+    }
+
+    const zx::su32 size {1280, 720};
+    const zx::u64  heap {zx::u64(size.w) * size.h * 6 + (1u << 20)}; // vw buffers (2.5) + test frame + yuyv
+
+    if ( not zx::mm::init(heap, false) ) return 1;
+
+    zx::tk::init(0);
+
+    ZX_NAME("dump");
+
+    zx::cf::conf conf {};
+    conf.lean = core::lean;
+    zx::vw::tune(conf);                              // before bind: only glyph and lean are taken
+
+    zx::sg::scene base {};
+    base.size = size;
+    base.cell = 3 * ((size.w + 320) / 640);          // markers land on the 15 pixel glyph
+    base.bays = zx::sg::grid(size, {6, 3}, 40);
+
+    std::vector<core::trial> trials {};
+
+    trials.push_back({ "clean", base });
+
+    { core::trial t { "noise",  base }; t.scene.noise = 8.0f;                       trials.push_back(t); }
+    { core::trial t { "turn",   base }; t.scene.turn  = 5.0f;                       trials.push_back(t); }
+    { core::trial t { "small",  base }; t.scene.cell  = base.cell * 4 / 5;          trials.push_back(t); }
+    { core::trial t { "large",  base }; t.scene.cell  = base.cell * 6 / 5;          trials.push_back(t); }
+    { core::trial t { "near",   base }; t.scene.cell  = base.cell * 5 / 3;          trials.push_back(t); }
+    { core::trial t { "dusk",   base }; t.scene.gain  = 0.35f; t.scene.noise = 3.0f; trials.push_back(t); }
+    { core::trial t { "glare",  base }; t.scene.gain  = 0.8f;  t.scene.bias  = 60.0f; trials.push_back(t); }
+    { core::trial t { "shade",  base }; t.scene.shade = 0.6f;                       trials.push_back(t); }
+    { core::trial t { "retune", base }; t.retune      = 3;                          trials.push_back(t); }
+    { core::trial t { "layout", base }; t.shape       = true;                       trials.push_back(t); }
+
+    std::printf("%-10s %9s %4s %4s  %5s %4s %4s  %4s %4s  %8s %8s\n",
+        "case", "markers", "prec", "rec", "lots", "prec", "rec", "prec", "rec", "detect", "fps");
+
+    for (const core::trial& t : trials) run(t);
+
+    if (core::trace) zx::tr::dump(core::trace);
+
+    zx::tk::stop();
+    zx::mm::stop();
+
+    return 0;
+}
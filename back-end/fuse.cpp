@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+
+//// SITE MERGE HARNESS
+//// two cameras overlapping by 1000 site units answer canned 'lots' replies, every step
+//// goes through the aggregator's mapping and merge and the delta a watcher would receive
+//// must match the expected BAY / DROP / CAMERA / DELTA lines. exit status 1 on a mismatch.
+
+namespace core {
+
+    struct step final {
+        const char  *name   {};
+        std::size_t  camera {};
+        std::string  reply  {};     // empty = camera down
+        std::string  delta  {};     // empty = table unchanged
+    };
+
+    static const char *plan {"/tmp/zx-fuse.conf"};
+}
+
+int main (void) noexcept
+{
+    std::FILE *file = std::fopen(core::plan, "w");
+
+    if (nullptr == file) return 1;
+
+    std::fprintf(file, "merge  = 0.3\n");
+    std::fprintf(file, "camera = 127.0.0.1 12345     0 0 4000 2250\n");
+    std::fprintf(file, "camera = 127.0.0.1 12346  3000 0 4000 2250\n");
+    std::fclose(file);
+
+    const bool loaded = zx::ms::load(core::plan);
+
+    std::remove(core::plan);
+
+    if (not loaded) return 1;
+
+    //// LOW RES 640x360 -> 6.25 SITE UNITS PER PIXEL. LOT 1 OF CAMERA 0 AND LOT 0 OF CAMERA 1
+    //// ARE THE SAME BAY (IOU 0.39), CAMERA 1 SEES IT LARGER
+    const std::string near =
+        "SIZE 640 360\n"
+        "LOT 0 0 0.100  10 10 100 100\n"
+        "LOT 1 1 0.800 520 10 100 100\n"
+        "LOTS: OK\n";
+
+    const std::string left =
+        "SIZE 640 360\n"
+        "LOT 1 1 0.800 520 10 100 100\n"
+        "LOTS: OK\n";
+
+    const std::string far =
+        "SIZE 640 360\n"
+        "LOT 0 1 0.900  32  10 160 160\n"
+        "LOT 1 0 0.200 500 200 100 100\n"
+        "LOTS: OK\n";
+
+    const std::vector<core::step> steps {
+        { "first", 0, near,
+            "CAMERA 0 127.0.0.1 12345 1\n"
+            "BAY 0 0 0.100 62.5 62.5 625.0 625.0 0 0\n"
+            "BAY 1 1 0.800 3250.0 62.5 625.0 625.0 0 0\n"
+            "DELTA: OK 1\n" },
+        { "overlap", 1, far,
+            "CAMERA 1 127.0.0.1 12346 1\n"
+            "BAY 1 1 0.900 3200.0 62.5 1000.0 1000.0 1 0\n"
+            "BAY 2 0 0.200 6125.0 1250.0 625.0 625.0 1 0\n"
+            "DELTA: OK 2\n" },
+        { "same", 0, near, "" },
+        { "down", 1, "",
+            "CAMERA 1 127.0.0.1 12346 0\n"
+            "BAY 1 1 0.800 3250.0 62.5 625.0 625.0 0 0\n"
+            "BAY 2 0 0.200 6125.0 1250.0 625.0 625.0 1 1\n"
+            "DELTA: OK 3\n" },
+        { "drop", 0, left,
+            "DROP 0\n"
+            "DELTA: OK 4\n" },
+        { "back", 1, far,
+            "CAMERA 1 127.0.0.1 12346 1\n"
+            "BAY 1 1 0.900 3200.0 62.5 1000.0 1000.0 1 0\n"
+            "BAY 2 0 0.200 6125.0 1250.0 625.0 625.0 1 0\n"
+            "DELTA: OK 5\n" },
+        { "garbled", 0, "LOT 0 0 0.1 10 10 100 100\nLOTS: OK\n",
+            "CAMERA 0 127.0.0.1 12345 0\n"
+            "DELTA: OK 6\n" },
+    };
+
+    int status = 0;
+
+    for (const core::step& s : steps) {
+
+        const std::string delta = zx::ms::feed(s.camera, s.reply);
+        const bool        good  = delta == s.delta;
+
+        std::printf("%-10s %s\n", s.name, good ? "ok" : "falhou");
+
+        if (not good) {
+            std::printf("esperado:\n%srecebido:\n%s", s.delta.c_str(), delta.c_str());
+            status = 1;
+        }
+    }
+
+    return status;
+}
@@ -1,25 +1,90 @@
-#include <chrono>
-#include <thread>
+#include <cstdio>
 
+#include "heap.hpp"
+#include "conf.hpp"
+#include "clck.hpp"
+#include "task.hpp"
 #include "view.hpp"
 #include "srvr.hpp"
+#include "shmp.hpp"
+#include "prvw.hpp"
+#include "elog.hpp"
+#include "pipe.hpp"
+#include "trce.hpp"
 
-int main (void) noexcept
+//// RELOAD - THRESHOLDS AND GEOMETRY LIVE, SERVERS RESTARTED WHEN THEIR ADDRESS CHANGED
+static void reload (const char* path) noexcept
 {
-    const zx::su32 size {640, 480};
-    const zx::u32  fps  {16};
+    const zx::cf::conf last = zx::cf::data();
 
-    zx::vw::init(size);
-    zx::sv::init(    );
+    if ( not zx::cf::load(path) ) return;
+
+    const zx::cf::conf& conf = zx::cf::data();
+    const zx::su32      view { zx::vw::image().width, zx::vw::image().height };
+
+    zx::vw::tune(conf);
+
+    if ( view.w != zx::vw::image().width or view.h != zx::vw::image().height ) {
+        zx::sm::stop();
+        zx::sm::init(conf.shm.c_str(), { zx::vw::image().width, zx::vw::image().height });
+    }
+
+    if ( conf.load != last.load ) zx::ck::init(conf.rate, conf.load);
+
+    if ( conf.bind != last.bind or conf.port != last.port ) {
+        zx::sv::stop();
+        zx::sv::init(conf.bind.c_str(), conf.port);
+    }
+
+    if ( conf.viewer != last.viewer or conf.preview != last.preview or conf.fps != last.fps ) {
+        zx::pv::stop();
+        if ( conf.preview ) zx::pv::init(conf.viewer.c_str(), conf.preview, conf.fps);
+    }
+
+    if ( conf.device != last.device or conf.size.w != last.size.w or conf.size.h != last.size.h or
+         conf.rate   != last.rate   or conf.shm    != last.shm    or conf.log    != last.log    or conf.lean != last.lean or
+         conf.camera != last.camera )
+        std::fprintf(stderr, "info: camera, shm, log, lean e id da camera so mudam ao reiniciar\n");
+}
+
+int main (int argc, char** argv) noexcept
+{
+    const char *path {argc > 1 ? argv[1] : "/etc/park/park.conf"}; // one file per instance
+
+    zx::cf::load(path);
+
+    const zx::cf::conf& conf = zx::cf::data();
+    const bool          lean {conf.lean};
+    const zx::u64       area {zx::u64(conf.size.w) * conf.size.h};
+    const zx::u64       heap {(lean ? area / 2 : area * 5 / 2) + (1u << 20)}; // low res <= 1/4 camera: 2 frames + 2 f32 score maps (lean: rows), half level and masks in the 1 MB
+
+    if ( not zx::mm::init(heap, true) ) return 1;
+
+    zx::tk::init(0);
+
+    zx::lg::init(conf.log.c_str(), conf.camera);
+    zx::vw::tune(conf);
+    zx::vw::init(conf.device.c_str(), conf.size, conf.rate);
+    zx::sv::init(conf.bind.c_str(), conf.port);
+    zx::sm::init(conf.shm.c_str(), { zx::vw::image().width, zx::vw::image().height });
+    if ( conf.preview ) zx::pv::init(conf.viewer.c_str(), conf.preview, conf.fps);
+    zx::ck::init(conf.rate, conf.load);
+
+    zx::pl::init(lean);                 // capture and publish threads, analysis below
+
+    ZX_NAME("analysis");
 
     bool running = true;
 
     while ( running )
     {
-        zx::vw::exec();
+        zx::pl::step();                 // newest frame, or a short wait
+
         zx::sv::proc();
 
-        if ( zx::sv::comm() ) {
+        while ( zx::sv::comm() ) {
+
+            ZX_SPAN("command");
 
             switch ( zx::sv::info().command ) {
 
@@ -35,15 +100,33 @@ int main (void) noexcept
                     zx::vw::check();
                 } break;
 
+                case zx::sv::scmd::RELOAD  : {
+                    zx::pl::stop();     // publishers and camera rebuilt with the stages idle
+                    reload(path);
+                    zx::pl::init(lean);
+                } break;
+
+                case zx::sv::scmd::TRACE   : {
+                    zx::tr::dump( zx::cf::data().trace.c_str() );
+                } break;
+
+                case zx::sv::scmd::REMAP   : {
+                    zx::vw::remap( zx::sv::info().area );
+                } break;
+
                 default: break;
             }
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(fps));
     }
 
+    zx::pl::stop();
+    zx::pv::stop();
+    zx::sm::stop();
     zx::sv::stop();
     zx::vw::stop();
+    zx::lg::stop();
+    zx::tk::stop();
+    zx::mm::stop();
 
     return 0;
 }
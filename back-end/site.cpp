@@ -0,0 +1,20 @@
+#include <cstdio>
+
+#include "mesh.hpp"
+
+//// SITE AGGREGATOR - one lot table over every park instance of the site
+int main (int argc, char** argv) noexcept
+{
+    const char *path {argc > 1 ? argv[1] : "/etc/park/site.conf"};
+
+    if ( not zx::ms::load(path) ) return 1;
+    if ( not zx::ms::init() )     return 1;
+
+    std::fprintf(stderr, "info: %zu cameras, painel em %s:%u\n",
+        zx::ms::data().cameras.size(), zx::ms::data().bind.c_str(), zx::ms::data().port);
+
+    zx::ms::run();                      // until SIGINT / SIGTERM
+    zx::ms::stop();
+
+    return 0;
+}